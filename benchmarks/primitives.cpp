@@ -0,0 +1,310 @@
+#include "bench.h"
+#include "engine_search.h"
+#include "evaluation.h"
+#include "game.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Times the core primitives of the engine in isolation over the bench positions.
+//
+// usage: benchmarks [--out file] [--baseline file] [--threshold percent] [--time ms]
+//
+// Results are written as json: {"primitives": {"<name>": {"ns_per_op": x, "ops": n}, ...}}.
+// With --baseline every primitive is compared against a previous result file and the exit code
+// is non zero if one of them got slower by more than the threshold (default 10%).
+
+using namespace Mondfisch;
+
+namespace {
+
+template <typename T> inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Measurement {
+    std::string name;
+    double nsPerOp;
+    uint64_t ops;
+};
+
+struct Corpus {
+    std::vector<std::string> fens;
+    std::vector<std::unique_ptr<Game>> games;
+    std::vector<MoveList> moves;
+    std::vector<MoveList> captures;
+};
+
+Corpus load_corpus() {
+    Corpus corpus;
+    for (auto fen : Bench::positions) {
+        auto game = std::make_unique<Game>();
+        game->loadFen(std::string(fen));
+        MoveList moves;
+        game->pseudo_legal_moves(moves);
+        MoveList captures;
+        for (auto move : moves) {
+            if (move.move.flags == MoveType::MOVE_CAPTURE) {
+                captures.push_back(move);
+            }
+        }
+        corpus.fens.emplace_back(fen);
+        corpus.moves.push_back(moves);
+        corpus.captures.push_back(captures);
+        corpus.games.push_back(std::move(game));
+    }
+    return corpus;
+}
+
+// Runs `pass` until `minTime` has elapsed. `pass` does one sweep over the corpus and returns the
+// number of operations it performed.
+template <typename F> Measurement measure(std::string name, int64_t minTime, F &&pass) {
+    for (uint8_t i = 0; i < 3; i++) {
+        pass();
+    }
+
+    uint64_t ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start;
+    do {
+        for (uint8_t i = 0; i < 16; i++) {
+            ops += pass();
+        }
+        end = std::chrono::steady_clock::now();
+    } while (std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() < minTime);
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return Measurement{name, ns / ops, ops};
+}
+
+std::vector<Measurement> run_all(Corpus &corpus, int64_t minTime) {
+    std::vector<Measurement> results;
+    const size_t n = corpus.games.size();
+
+    results.push_back(measure("pseudo_legal_moves", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            MoveList moves;
+            game->pseudo_legal_moves(moves);
+            do_not_optimize(moves.count);
+        }
+        return n;
+    }));
+
+    results.push_back(measure("legal_moves", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            MoveList moves;
+            game->legal_moves(moves);
+            do_not_optimize(moves.count);
+        }
+        return n;
+    }));
+
+    results.push_back(measure("make_undo_move", minTime, [&]() {
+        uint64_t ops = 0;
+        for (size_t i = 0; i < n; i++) {
+            Game &game = *corpus.games[i];
+            for (auto move : corpus.moves[i]) {
+                game.make_move(move.move);
+                do_not_optimize(game.hash);
+                game.undo_move(move.move);
+            }
+            ops += corpus.moves[i].size();
+        }
+        return ops;
+    }));
+
+    results.push_back(measure("see", minTime, [&]() {
+        uint64_t ops = 0;
+        for (size_t i = 0; i < n; i++) {
+            Game &game = *corpus.games[i];
+            for (auto move : corpus.captures[i]) {
+                int32_t value = game.see(move.move.from, move.move.to, game.color);
+                do_not_optimize(value);
+            }
+            ops += corpus.captures[i].size();
+        }
+        return ops;
+    }));
+
+    results.push_back(measure("see_ge", minTime, [&]() {
+        uint64_t ops = 0;
+        for (size_t i = 0; i < n; i++) {
+            Game &game = *corpus.games[i];
+            for (auto move : corpus.captures[i]) {
+                bool value = game.see_ge(move.move, 0);
+                do_not_optimize(value);
+            }
+            ops += corpus.captures[i].size();
+        }
+        return ops;
+    }));
+
+    results.push_back(measure("attack_info", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            game->compute_attack_info();
+            do_not_optimize(game->attackInfo.attacks);
+        }
+        return n;
+    }));
+
+    results.push_back(measure("is_check", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            bool check = game->is_check(game->color);
+            do_not_optimize(check);
+        }
+        return n;
+    }));
+
+    results.push_back(measure("tapered_eval", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            int32_t eval = Evaluation::tapered_eval(*game);
+            do_not_optimize(eval);
+        }
+        return n;
+    }));
+
+    // child hashes of the corpus spread the accesses over the whole table like in a search
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < n; i++) {
+        Game &game = *corpus.games[i];
+        for (auto move : corpus.moves[i]) {
+            game.make_move(move.move);
+            hashes.push_back(game.hash);
+            game.undo_move(move.move);
+        }
+    }
+    Search::TranspositionTable table{};
+    table.setsize(16);
+
+    results.push_back(measure("tt_update", minTime, [&]() {
+        for (size_t i = 0; i < hashes.size(); i++) {
+            table.update(hashes[i], 1, i & 15, Move{}, i & 1023, Search::NodeType::EXACT, 0);
+        }
+        return hashes.size();
+    }));
+
+    results.push_back(measure("tt_probe", minTime, [&]() {
+        Search::TableEntry entry;
+        for (uint64_t hash : hashes) {
+            bool hit = table.probe(hash, entry, 0);
+            do_not_optimize(hit);
+        }
+        return hashes.size();
+    }));
+
+    results.push_back(measure("loadFen", minTime, [&]() {
+        Game &game = *corpus.games[0];
+        for (auto &fen : corpus.fens) {
+            game.loadFen(fen);
+            do_not_optimize(game.hash);
+        }
+        game.loadFen(corpus.fens[0]);
+        return n;
+    }));
+
+    results.push_back(measure("dumpFen", minTime, [&]() {
+        for (auto &game : corpus.games) {
+            std::string fen = game->dumpFen();
+            do_not_optimize(fen.size());
+        }
+        return n;
+    }));
+
+    return results;
+}
+
+std::string to_json(const std::vector<Measurement> &results) {
+    std::string json = "{\n  \"primitives\": {\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        json += std::format("    \"{}\": {{\"ns_per_op\": {:.2f}, \"ops\": {}}}", results[i].name,
+                            results[i].nsPerOp, results[i].ops);
+        json += i + 1 < results.size() ? ",\n" : "\n";
+    }
+    json += "  }\n}\n";
+    return json;
+}
+
+// only understands the format written by to_json
+bool baseline_value(const std::string &json, const std::string &name, double &value) {
+    size_t pos = json.find(std::format("\"{}\"", name));
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = json.find("\"ns_per_op\":", pos);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    value = std::strtod(json.c_str() + pos + std::string_view("\"ns_per_op\":").size(), nullptr);
+    return value > 0;
+}
+
+bool compare(const std::vector<Measurement> &results, const std::string &baseline,
+             double threshold) {
+    bool ok = true;
+    std::print(stderr, "{:<20} {:>12} {:>12} {:>9}\n", "primitive", "baseline ns", "ns", "change");
+    for (auto &result : results) {
+        double base;
+        if (!baseline_value(baseline, result.name, base)) {
+            std::print(stderr, "{:<20} {:>12} {:>12.2f}\n", result.name, "-", result.nsPerOp);
+            continue;
+        }
+        double change = (result.nsPerOp - base) / base * 100;
+        bool regression = change > threshold;
+        ok &= !regression;
+        std::print(stderr, "{:<20} {:>12.2f} {:>12.2f} {:>+8.1f}%{}\n", result.name, base,
+                   result.nsPerOp, change, regression ? "  REGRESSION" : "");
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string out;
+    std::string baselineFile;
+    double threshold = 10;
+    int64_t minTime = 250;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--out") {
+            out = argv[i + 1];
+        } else if (arg == "--baseline") {
+            baselineFile = argv[i + 1];
+        } else if (arg == "--threshold") {
+            threshold = std::strtod(argv[i + 1], nullptr);
+        } else if (arg == "--time") {
+            minTime = std::strtoll(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    initConstants();
+    Corpus corpus = load_corpus();
+    std::vector<Measurement> results = run_all(corpus, minTime);
+    std::string json = to_json(results);
+
+    if (out.empty()) {
+        std::print("{}", json);
+    } else {
+        std::ofstream(out) << json;
+    }
+
+    if (!baselineFile.empty()) {
+        std::ifstream file(baselineFile);
+        if (!file.is_open()) {
+            std::print(stderr, "could not open baseline {}\n", baselineFile);
+            return 2;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return compare(results, ss.str(), threshold) ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "engine_search.h"
+#include "game.h"
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <thread>
+
+namespace Mondfisch::Api {
+
+// 0 means no limit, without any limit the search runs to max_depth or until stop()
+struct Limits {
+    uint32_t depth = 0;
+    uint64_t nodes = 0;
+    // milliseconds
+    uint64_t movetime = 0;
+    // mate in moves
+    uint32_t mate = 0;
+};
+
+// called from the searching thread for every completed iteration
+using InfoCallback = std::function<void(const Search::SearchResult &)>;
+
+// An engine for use inside another program without the uci text protocol. Every instance owns
+// its position, transposition table and search state, so instances may search in parallel.
+struct Engine {
+    Game game{};
+    Search::TranspositionTable table{};
+    Search::SearchContext ctx{};
+    Search::SearchResult result{};
+    std::thread searcher;
+
+    explicit Engine(uint32_t hashMb = 16);
+    ~Engine();
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    // forgets the position and everything learned in earlier searches
+    void newGame();
+    void setHash(uint32_t mb);
+    // Hash, SearchVariant and the search coefficients by their uci option names, false for
+    // unknown options
+    bool setOption(std::string_view name, std::string_view value);
+
+    // startpos if fen is empty. False if the fen is not valid, the position is kept then, missing
+    // castling, en passant and move counter fields default to "- - 0 1". The moves are given in
+    // uci notation, false if one of them is not legal, the moves before it stay played.
+    bool setPosition(std::string_view fen, std::span<const std::string_view> moves = {});
+    // plays a move in uci notation on the current position, false if it is not legal
+    bool playMove(std::string_view move);
+
+    // Without a legal move the best move is the null move, the score is -mate if the side to
+    // move is checkmated and 0 for a stalemate. A search stopped before its first iteration
+    // completes returns a legal move at depth 0.
+    Search::SearchResult search(const Limits &limits, InfoCallback callback = {});
+    // searches in a background thread, the result is returned by wait()
+    void start(const Limits &limits, InfoCallback callback = {});
+    void stop();
+    const Search::SearchResult &wait();
+
+    // static evaluation in centipawns from the view of the side to move
+    Search::Score evaluate();
+
+  private:
+    // searches with the clock started
+    void run(const Limits &limits, InfoCallback callback);
+};
+
+} // namespace Mondfisch::Api
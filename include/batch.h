@@ -0,0 +1,85 @@
+#pragma once
+
+#include "engine_search.h"
+#include "game.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Mondfisch::Batch {
+
+// Calls body(state, i) for every i < count on the given number of threads. Every thread owns one
+// state made by init, indices are handed out one by one so that slow items balance out.
+template <typename Init, typename Body>
+void parallel_for(size_t count, uint32_t threads, Init init, Body body) {
+    threads = std::clamp<uint32_t>(threads, 1, std::max<size_t>(count, 1));
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        auto state = init();
+        for (size_t i = next++; i < count; i = next++) {
+            body(state, i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32_t i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+}
+
+// A fen from a fen or an epd line. The four position fields are kept, the move counters only if
+// they follow them, everything else (epd operations) is dropped.
+std::string epd_to_fen(std::string_view epd);
+
+// The search state of one thread.
+struct Worker {
+    Game game{};
+    Search::TranspositionTable table{};
+    Search::SearchContext ctx{};
+
+    explicit Worker(uint32_t hash, const Search::SearchParams &params = {});
+
+    // loads the position and clears what earlier searches left behind, so that the result does
+    // not depend on which positions the worker saw before
+    void load(const std::string &fen);
+};
+
+// without a depth and a node limit the positions are scored with the static evaluation
+struct Options {
+    // 0 searches to max_depth if there is a node limit
+    uint32_t depth = 0;
+    uint64_t nodes = 0;
+    uint32_t hash = 1;
+    uint32_t threads = 1;
+
+    bool searches() const { return depth > 0 || nodes > 0; }
+};
+
+struct Result {
+    // from the view of the side to move
+    Search::Score score = 0;
+    // null for the static evaluation
+    Move bestMove{};
+    uint64_t nodes = 0;
+};
+
+struct Summary {
+    uint64_t nodes = 0;
+    int64_t elapsed = 0;
+    double positionsPerSecond = 0;
+};
+
+// Scores fens or epd lines, results[i] belongs to lines[i].
+Summary evaluate(std::span<const std::string> lines, const Options &options,
+                 std::vector<Result> &results);
+
+} // namespace Mondfisch::Batch
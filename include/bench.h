@@ -0,0 +1,28 @@
+#pragma once
+
+#include "engine_search.h"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace Mondfisch::Bench {
+
+constexpr uint32_t default_depth = 7;
+constexpr uint32_t default_hash = 16;
+constexpr uint32_t default_threads = 1;
+
+// first 50 positions of tests/data/arasan2024.epd
+extern const std::array<std::string_view, 50> positions;
+
+struct BenchResult {
+    uint64_t nodes = 0;
+    int64_t elapsed = 0;
+    uint64_t nps = 0;
+};
+
+// Searches every bench position from a cleared state to a fixed depth. The node count only
+// depends on the search itself and serves as a signature of the build.
+BenchResult run(uint32_t depth, uint32_t hash, uint32_t threads,
+               const Search::SearchParams &params = {});
+
+} // namespace Mondfisch::Bench
@@ -1,9 +1,16 @@
 #pragma once
 
 #include "game.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace Mondfisch::Search {
@@ -11,12 +18,16 @@ namespace Mondfisch::Search {
 using Score = int16_t;
 
 constexpr uint8_t max_depth = 64;
+constexpr uint16_t max_ply = 2 * max_depth;
 constexpr Score mate = 30000;
 constexpr Score mate_threshold = 29000;
 constexpr Score max_value = 32000;
 constexpr Score loss_value = -mate;
+constexpr Score no_score = -max_value;
 
 constexpr int32_t max_history = 10000;
+// minimum time between two reported iterations, the last one is always reported
+constexpr std::chrono::milliseconds report_interval{50};
 
 constexpr uint8_t node_shift = 6;
 constexpr uint8_t gen_mask = 0b00111111;
@@ -38,15 +49,22 @@ struct TableEntry {
     inline uint8_t age() const { return gen & gen_mask; }
 
     inline NodeType type() const { return NodeType(gen & node_mask); }
+
+    // quiescence entries have depth 0, so only a missing node type marks an unused slot
+    inline bool empty() const { return (gen & node_mask) == 0; }
 };
 
 struct SearchResult {
     Score score;
     Move bestMove;
     uint64_t nodes;
-    std::vector<Move> pv;
+    std::array<Move, max_ply> pv;
+    uint8_t pvLength;
     uint32_t depth;
+    uint32_t selDepth;
     int64_t elapsed;
+
+    inline std::span<const Move> pvMoves() const { return {pv.data(), pvLength}; }
 };
 
 struct TranspositionTable {
@@ -66,49 +84,282 @@ struct TranspositionTable {
     TableEntry &operator[](size_t i) { return table[i]; }
     const TableEntry &operator[](size_t i) const { return table[i]; }
 
+    // permill of used entries, estimated from the start of the table
     uint32_t hashFull() const;
 };
 
+inline int16_t score_to_tt(int16_t score, int ply) {
+    if (score > mate_threshold) {
+        return score + ply;
+    }
+    if (score < -mate_threshold) {
+        return score - ply;
+    }
+    return score;
+}
+
+inline int16_t score_from_tt(int16_t score, int ply) {
+    if (score > mate_threshold) {
+        return score - ply;
+    }
+    if (score < -mate_threshold) {
+        return score + ply;
+    }
+    return score;
+}
+
+inline bool TranspositionTable::probe(uint64_t hash, TableEntry &entry, uint8_t ply) const {
+    entry = get(hash);
+    if (entry.empty() || entry.hash != hash) {
+        return false;
+    }
+    entry.score = score_from_tt(entry.score, ply);
+    return true;
+}
+
+inline void TranspositionTable::update(uint64_t hash, uint8_t gen, uint32_t depth, Move bestMove,
+                                       Score bestScore, NodeType flag, uint8_t ply) {
+    TableEntry &entry = get(hash);
+    bestScore = score_to_tt(bestScore, ply);
+    if (depth >= entry.depth || entry.age() != gen) {
+        entry.score = bestScore;
+        entry.best = bestMove;
+        entry.depth = depth;
+        entry.hash = hash;
+        entry.gen = uint8_t(flag) | gen;
+    }
+}
+
+#ifdef SEARCH_STATS
+constexpr bool collect_stats = true;
+#else
+constexpr bool collect_stats = false;
+#endif
+
+// Counters about the behaviour of the search. They are only collected when building with
+// SEARCH_STATS, otherwise every increment compiles to nothing.
+struct SearchStats {
+    uint64_t qnodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    uint64_t ttCutoffs = 0;
+    uint64_t betaCutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    uint64_t nullMoveTries = 0;
+    uint64_t nullMoveCutoffs = 0;
+    uint64_t rfpTries = 0;
+    uint64_t rfpCutoffs = 0;
+    uint64_t razorTries = 0;
+    uint64_t razorCutoffs = 0;
+    uint64_t futilityPrunes = 0;
+    uint64_t lmpPrunes = 0;
+    uint64_t iirReductions = 0;
+    uint64_t probcutTries = 0;
+    uint64_t probcutCutoffs = 0;
+    uint64_t lmrTries = 0;
+    uint64_t lmrResearches = 0;
+    uint64_t pvsResearches = 0;
+    uint64_t seeCalls = 0;
+    uint64_t evalCalls = 0;
+    std::array<uint64_t, max_depth + 1> iterationNodes{};
+
+    SearchStats &operator+=(const SearchStats &other);
+    double ebf(uint32_t depth) const;
+    // the counters as text or as a json object, appended to out without temporary strings
+    void appendTo(std::string &out, uint32_t depth, uint64_t nodes) const;
+    void appendJsonTo(std::string &out) const;
+};
+
+inline void count(uint64_t &counter) {
+    if constexpr (collect_stats) {
+        counter++;
+    }
+}
+
+// pieces of both colors, used to index the move ordering tables
+constexpr uint8_t history_pieces = 12;
+
+inline uint8_t history_piece(uint8_t piece) {
+    return color_from_piece(piece) * 6 + uint8_t(piece_from_piece(piece));
+}
+
+// history of a move given the piece and target of an earlier move, [piece][to]
+using PieceToHistory = std::array<std::array<int16_t, 64>, history_pieces>;
+// [previous piece][previous to][piece][to], one PieceToHistory per previous move so that all
+// lookups of a node hit the same 1.5kB block
+using ContinuationHistory = std::array<std::array<PieceToHistory, 64>, history_pieces>;
+
 struct StackElement {
-    uint16_t ply = 0;
-    bool allowNullMove = 0;
+    Score staticEval = no_score;
+    bool inCheck = false;
+    Move move{};
+    uint8_t piece = 0;
+    Move excluded{};
+    uint8_t pvLength = 0;
+    std::array<Move, max_ply> pv{};
+};
+
+// Search features that a variant can leave out. The search is instantiated once per variant, so
+// the switches are resolved at compile time and cost nothing at the nodes.
+struct SearchFeatures {
+    bool nullMove = true;
+    bool reverseFutility = true;
+    bool razoring = true;
+    bool probcut = true;
+    bool iir = true;
+    bool lmp = true;
+    bool futility = true;
+    bool deltaPruning = true;
+    bool lmr = true;
+    bool killers = true;
+    bool counterMoves = true;
+    // quiet, continuation and capture history
+    bool history = true;
 };
 
+struct SearchVariant {
+    std::string_view name;
+    SearchFeatures features;
+};
+
+// selected by the SearchVariant option, the first one is the default
+constexpr std::array search_variants{
+    SearchVariant{"Default", {}},
+    SearchVariant{"NoNullMove", {.nullMove = false}},
+    SearchVariant{"NoRfp", {.reverseFutility = false}},
+    SearchVariant{"NoProbcut", {.probcut = false}},
+    SearchVariant{"NoLmp", {.lmp = false}},
+    SearchVariant{"NoLmr", {.lmr = false}},
+    SearchVariant{"NoKillers", {.killers = false}},
+    SearchVariant{"NoHistory", {.history = false}},
+    SearchVariant{"NoPruning",
+                  {.nullMove = false,
+                   .reverseFutility = false,
+                   .razoring = false,
+                   .probcut = false,
+                   .iir = false,
+                   .lmp = false,
+                   .futility = false,
+                   .deltaPruning = false}},
+};
+
+// Tunable search coefficients. Tables derived from them are rebuilt by init().
+struct SearchParams {
+    // late move reductions: base + log(depth) * log(moveCount) / divisor, both in 1/100
+    int32_t lmrBase = 100;
+    int32_t lmrDivisor = 300;
+    // index into search_variants
+    uint8_t variant = 0;
+
+    std::array<std::array<uint8_t, 256>, max_depth + 1> reductions{};
+
+    SearchParams() { init(); }
+
+    void init();
+    // sets the uci option of a coefficient, false if there is none with this name
+    bool set(std::string_view name, int32_t value);
+    // false if there is no variant with this name
+    bool setVariant(std::string_view name);
+    std::string_view variantName() const { return search_variants[variant].name; }
+
+    inline int32_t reduction(int32_t depth, uint8_t moveCount, bool isPv, bool improving,
+                             int32_t history) const {
+        int32_t r = reductions[std::min<int32_t>(depth, max_depth)][moveCount];
+        r -= isPv;
+        r += !improving;
+        r -= std::clamp(history / (max_history / 2), -1, 1);
+        return std::max(r, 0);
+    }
+};
+
+// probcut: a capture that beats beta + margin at depth - reduction most likely beats beta at depth
+constexpr int32_t probcut_depth = 5;
+constexpr int32_t probcut_reduction = 4;
+constexpr Score probcut_margin = 200;
+
+// internal iterative reduction: minimum depth in pv and in non pv nodes. Pv nodes are rare and
+// their result is reported, so they are only reduced far from the horizon.
+constexpr int32_t iir_pv_depth = 6;
+constexpr int32_t iir_non_pv_depth = 4;
+
+// late move pruning: number of moves after which quiet moves are skipped, [improving][depth]
+constexpr uint8_t lmp_depth = 8;
+constexpr auto lmp_counts = []() {
+    std::array<std::array<uint8_t, lmp_depth + 1>, 2> counts{};
+    for (uint8_t depth = 0; depth <= lmp_depth; depth++) {
+        counts[0][depth] = (3 + depth * depth) / 2;
+        counts[1][depth] = 3 + depth * depth;
+    }
+    return counts;
+}();
+
 struct SearchContext {
-    bool stop = false;
+    // may be set by another thread to end the search
+    std::atomic<bool> stop = false;
+    bool report = true;
+    // receives every completed iteration instead of the uci output
+    std::function<void(const SearchResult &)> onIteration;
     uint64_t thinkingTime = 0;
+    uint64_t nodeLimit = 0;
+    uint32_t mateLimit = 0;
     uint64_t nodes = 0;
+    // deepest ply reached, root is ply 1
+    uint32_t selDepth = 0;
+    SearchStats stats{};
     std::chrono::steady_clock::time_point timeStart;
+    // last time an iteration was reported, reports are throttled
+    std::chrono::steady_clock::time_point lastReport{};
     uint8_t gen = 0;
     TranspositionTable *table = nullptr;
-    std::array<std::array<Move, 2>, max_depth> killers{};
+    SearchParams params{};
+    std::array<std::array<Move, 2>, max_ply> killers{};
     std::array<std::array<std::array<int32_t, 64>, 64>, 2> history{};
+    std::array<std::array<Move, 64>, history_pieces> counterMoves{};
+    // [moving piece][to][captured piece]
+    std::array<std::array<std::array<int16_t, 6>, 64>, history_pieces> captureHistory{};
+    // shared by the one and two ply continuation, too large to live on the stack
+    std::unique_ptr<ContinuationHistory> contHist = std::make_unique<ContinuationHistory>();
     MoveList moves;
-    // StackList<StackElement, max_depth> stack{};
+    std::array<StackElement, max_ply + 1> stack{};
 
     void reset();
     void resetSearch();
     void history_decay();
+    // starts a search, a stop requested after this is not lost
     void startTimer();
     bool timeUp() const;
+
+    inline void checkLimits() {
+        if (nodeLimit > 0 && nodes >= nodeLimit) {
+            stop = true;
+        } else if ((nodes & 2047) == 0 && timeUp()) {
+            stop = true;
+        }
+    }
 };
 
 bool is_mate(Score score);
 
-void score_moves(SearchContext &ctx, Game &game, MoveList &moves);
+// number of moves until mate, positive if the side to move mates
+int32_t mate_in(Score score);
+
+template <SearchFeatures features = SearchFeatures{}>
+void score_moves(SearchContext &ctx, Game &game, MoveList &moves, int32_t ply);
 
 void sort_moves(MoveList &moves);
 
+template <SearchFeatures features = SearchFeatures{}>
 Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_t depth,
              int32_t ply, bool is_pv, bool allowNullMove);
 
-Score quiescence(SearchContext &ctx, Game &game, Score alpha, Score beta);
+template <SearchFeatures features = SearchFeatures{}>
+Score quiescence(SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t ply);
 
 Score test_search_root(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_t depth);
 
+template <SearchFeatures features = SearchFeatures{}>
 Score search_root(SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t depth);
 
-void calculate_pv_moves(SearchContext &ctx, Game &game, std::vector<Move> &moves, int8_t depth);
-
+// searches the iterations with the variant selected in the params of ctx
 SearchResult iterative_deepening(SearchContext &ctx, Game &game, uint32_t depth);
 } // namespace Mondfisch::Search
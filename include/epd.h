@@ -0,0 +1,59 @@
+#pragma once
+
+#include "game.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Mondfisch::Epd {
+
+// A test position, solved by playing one of the best moves or none of the moves to avoid.
+struct Entry {
+    std::string fen;
+    std::string id;
+    std::vector<Move> bestMoves;
+    std::vector<Move> avoidMoves;
+
+    bool solvedBy(Move move) const;
+};
+
+// Reads the position and the bm, am and id operations of an epd line. False if it has neither bm
+// nor am or one of their moves is not a legal move in standard algebraic notation.
+bool parse(std::string_view line, Game &game, Entry &entry);
+
+// 0 means no limit
+struct Options {
+    // per position in milliseconds
+    uint64_t time = 0;
+    uint64_t nodes = 0;
+    uint32_t depth = 0;
+    uint32_t hash = 16;
+    uint32_t threads = 1;
+};
+
+struct Result {
+    Move bestMove{};
+    bool solved = false;
+    uint32_t depth = 0;
+    // since the search last switched to a solving move and kept it, -1 if unsolved
+    int64_t timeToSolution = -1;
+    uint64_t nodesToSolution = 0;
+    uint64_t nodes = 0;
+    int64_t elapsed = 0;
+};
+
+struct Summary {
+    uint32_t solved = 0;
+    uint64_t nodes = 0;
+    // wall clock time of the whole run and the sum of the search times
+    int64_t elapsed = 0;
+    int64_t searchTime = 0;
+    uint64_t nps = 0;
+};
+
+// Searches every entry from cleared tables, results[i] belongs to entries[i].
+Summary run(std::span<const Entry> entries, const Options &options, std::vector<Result> &results);
+
+} // namespace Mondfisch::Epd
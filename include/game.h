@@ -8,6 +8,8 @@
 #include <iterator>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Mondfisch {
 
@@ -35,6 +37,10 @@ constexpr std::array<std::array<std::string, numberChessPieces + 1>, 2> pieceSym
     {"♔", "♕", "♖", "♗", "♘", "♙", " "},
 }};
 constexpr std::array<char, 8> files{'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h'};
+// plies of game history reserved up front, longer games grow the history
+constexpr size_t history_capacity = 1024;
+// longest simple notation of a move, e.g. e7e8q
+constexpr size_t max_notation_length = 5;
 constexpr std::array<int8_t, 2> signedColor{1, -1};
 
 inline std::array<std::array<BitBoard, 9>, 2> epMasks;
@@ -139,6 +145,7 @@ std::string pos2str(Position pos);
 std::string getPieceSymbol(uint8_t piece);
 void showBitBoard(BitBoard board);
 uint8_t char2Piece(char c);
+uint64_t splitmix64(uint64_t &state);
 void initConstants();
 
 struct BitIterator {
@@ -174,6 +181,8 @@ struct Move {
 
     std::string toAlgebraicNotation(uint8_t coloredPiece) const;
     std::string toSimpleNotation() const;
+    // writes the simple notation without allocating, returns the end of the written characters
+    char *writeSimpleNotation(char *out) const;
     std::string toString() const;
 
     inline bool is_capture() {
@@ -243,6 +252,19 @@ template <typename T, std::size_t N> struct StackList {
 
 using MoveList = StackList<ScoreMove, 256>;
 
+// Attacks of both sides in one position. Game::attack_info() computes them on first use and
+// keeps them until the position changes, so move ordering and SEE of a node share a single
+// attack generation.
+struct AttackInfo {
+    uint64_t hash = 0;
+    bool valid = false;
+    // every square attacked by a side
+    std::array<BitBoard, 2> attacks{};
+    std::array<BitBoard, 2> pawnAttacks{};
+    // squares attacked by bishops, rooks and queens, a piece on them may pin or block a slider
+    std::array<BitBoard, 2> sliderAttacks{};
+};
+
 struct Game {
     std::array<std::array<BitBoard, numberChessPieces>, 2> bitboard{};
     std::array<uint8_t, 64> board{};
@@ -254,15 +276,26 @@ struct Game {
     std::array<BitBoard, 2> occupancy{0, 0};
     BitBoard occupancyBoth = 0;
     uint64_t hash = 0;
+    // undo information of the moves made by the search, moves played by playMove are not kept
     StackList<UndoMove, 1024> undoStack{};
-    StackList<uint64_t, 1024> history{};
+    // hashes of all positions since the last reset, grows with the game
+    std::vector<uint64_t> history{};
+    AttackInfo attackInfo{};
 
     inline BitBoard occupancy_of(Piece piece) {
         return bitboard[WHITE][uint8_t(piece)] | bitboard[BLACK][uint8_t(piece)];
     }
 
+    inline const AttackInfo &attack_info() {
+        if (!attackInfo.valid || attackInfo.hash != hash) {
+            compute_attack_info();
+        }
+        return attackInfo;
+    }
+
     void reset();
     void calculateOccupancy();
+    void compute_attack_info();
     void generate_king_captures(Position pos, MoveList &moves);
     void generate_king_moves(Position pos, MoveList &moves);
     void generate_rook_moves(Position pos, MoveList &moves);
@@ -280,6 +313,8 @@ struct Game {
     BitBoard attacks_to(Position pos, uint8_t color);
     BitBoard attacks_to(Position pos);
     int32_t see(Position from, Position target, uint8_t color);
+    // static exchange evaluation of `move` for the side to move is at least `threshold`
+    bool see_ge(Move move, int32_t threshold);
     bool is_draw();
     bool is_insufficient_material();
     bool is_repetition_draw();
@@ -292,7 +327,12 @@ struct Game {
     bool is_pseudo_legal(Move move);
     void move_piece(Position from, Position to, Piece pieceFrom, uint8_t pieceTo);
     void move_piece(Position from, Position to);
-    void playMove(std::string &move);
+    // plays a move in simple notation as part of the game, it can not be undone
+    void playMove(std::string_view move);
+    // the legal move given in standard algebraic notation, null if there is none or it is ambiguous
+    Move parseSan(std::string_view san);
+    // standard algebraic notation of a legal move
+    std::string toSan(Move move);
     void make_move(Move move);
     void undo_move(Move move);
     void make_null_move();
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace Mondfisch {
+
+enum class LogLevel : uint8_t {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    NONE,
+};
+
+constexpr std::string_view toString(LogLevel level) {
+    switch (level) {
+    case LogLevel::DEBUG:
+        return "debug";
+    case LogLevel::INFO:
+        return "info";
+    case LogLevel::WARN:
+        return "warn";
+    case LogLevel::ERROR:
+        return "error";
+    default:
+        return "none";
+    }
+}
+
+LogLevel log_level_from_string(std::string_view s);
+
+// number of messages that can wait for the writer thread, a power of two
+constexpr uint64_t log_capacity = 4096;
+// longer messages are cut
+constexpr size_t log_message_size = 256;
+// the writer thread sleeps this long when there is nothing to write
+constexpr std::chrono::milliseconds log_drain_interval{2};
+
+struct LogRecord {
+    // the slot is free for the producer of position sequence and readable for the writer at
+    // sequence + 1
+    std::atomic<uint64_t> sequence;
+    int64_t micros;
+    LogLevel level;
+    uint16_t length;
+    std::array<char, log_message_size> text;
+};
+
+// Asynchronous logger. Messages are formatted by the calling thread into a fixed ring buffer
+// and written by a background thread, so logging never blocks, allocates or does io in the
+// caller. Any number of threads may log at the same time (bounded mpsc queue after Vyukov).
+// When the buffer is full the message is dropped and counted instead of waiting.
+struct Logger {
+    std::unique_ptr<std::array<LogRecord, log_capacity>> records;
+    alignas(64) std::atomic<uint64_t> head{0};
+    // next record to write, only touched by the writer thread
+    alignas(64) uint64_t tail = 0;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<LogLevel> level{LogLevel::NONE};
+    std::atomic<bool> running{false};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::FILE *file = nullptr;
+    std::string filename;
+    std::string line;
+    std::thread writer;
+
+    Logger();
+    ~Logger() { close(); }
+
+    // writes to the file, to stderr if the name is empty. Nothing changes if the logger already
+    // writes there.
+    bool open(const std::string &name);
+    // writes all pending messages and stops the writer thread
+    void close();
+
+    void setLevel(LogLevel l) { level.store(l, std::memory_order_relaxed); }
+    bool isOpen() const { return running.load(std::memory_order_relaxed); }
+
+    // callers may skip preparing arguments for messages that would be discarded
+    bool enabled(LogLevel l) const {
+        return l >= level.load(std::memory_order_relaxed) && isOpen();
+    }
+
+    template <typename... Args>
+    void log(LogLevel l, std::format_string<Args...> fmt, Args &&...args) {
+        if (!enabled(l)) {
+            return;
+        }
+        uint64_t pos;
+        LogRecord *record = claim(pos);
+        if (record == nullptr) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        record->micros =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+        record->level = l;
+        auto result = std::format_to_n(record->text.data(), record->text.size(), fmt,
+                                       std::forward<Args>(args)...);
+        record->length = std::min<size_t>(result.size, record->text.size());
+        record->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    template <typename... Args> void debug(std::format_string<Args...> fmt, Args &&...args) {
+        log(LogLevel::DEBUG, fmt, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args> void info(std::format_string<Args...> fmt, Args &&...args) {
+        log(LogLevel::INFO, fmt, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args> void warn(std::format_string<Args...> fmt, Args &&...args) {
+        log(LogLevel::WARN, fmt, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args> void error(std::format_string<Args...> fmt, Args &&...args) {
+        log(LogLevel::ERROR, fmt, std::forward<Args>(args)...);
+    }
+
+  private:
+    inline LogRecord *claim(uint64_t &pos) {
+        pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            LogRecord &record = (*records)[pos & (log_capacity - 1)];
+            uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(sequence - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &record;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // writes the published messages, returns their number
+    size_t drain();
+    void run();
+};
+
+inline Logger logger{};
+
+} // namespace Mondfisch
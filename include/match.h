@@ -0,0 +1,87 @@
+#pragma once
+
+#include "api.h"
+#include "engine_search.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Mondfisch::Match {
+
+// Adjudication: a win once the score stayed beyond resign_score for resign_plies, a draw once it
+// stayed within draw_score for draw_plies after draw_start plies, and a draw after max_plies.
+constexpr Search::Score resign_score = 1000;
+constexpr uint32_t resign_plies = 6;
+constexpr Search::Score draw_score = 10;
+constexpr uint32_t draw_plies = 12;
+constexpr uint32_t draw_start = 80;
+constexpr uint32_t max_plies = 400;
+
+struct Opening {
+    std::string fen;
+    // uci notation
+    std::vector<std::string> moves;
+};
+
+struct TimeControl {
+    // milliseconds, a base of 0 searches every move with the node limit
+    int64_t base = 0;
+    int64_t increment = 0;
+    uint64_t nodes = 0;
+};
+
+struct GameRecord {
+    // 1 if white won, 0 for a draw, -1 if black won
+    int32_t result = 0;
+    std::string termination;
+    std::string fen;
+    // standard algebraic notation, numbered from the fen
+    std::string movetext;
+};
+
+// random moves from the start position that do not end the game
+Opening random_opening(uint32_t plies, uint64_t seed);
+
+// Plays the opening and then the engines against each other until the game ends by the rules, by
+// a time forfeit or by adjudication. Both engines start a new game.
+GameRecord play(Api::Engine &white, Api::Engine &black, const Opening &opening,
+                const TimeControl &control);
+
+std::string_view result_string(int32_t result);
+
+std::string to_pgn(const GameRecord &record, uint32_t round, std::string_view white,
+                   std::string_view black);
+
+// Games of one side. The elo estimate, its error and the log likelihood ratio of the sequential
+// probability ratio test use the normal approximation of the score per game.
+struct Score {
+    uint32_t wins = 0;
+    uint32_t losses = 0;
+    uint32_t draws = 0;
+
+    void add(int32_t result);
+    uint32_t games() const { return wins + losses + draws; }
+    double mean() const;
+    double variance() const;
+    double elo() const { return elo(mean()); }
+    // half of the 95% confidence interval of the elo estimate
+    double error() const;
+    // log likelihood ratio of elo1 against elo0
+    double llr(double elo0, double elo1) const;
+
+    static double elo(double score);
+    // expected score against an opponent rated elo lower
+    static double expected(double elo);
+};
+
+// the sprt accepts H0 (elo0) once the llr falls to the lower bound and H1 once it reaches the
+// upper one, alpha and beta are the error probabilities
+struct Sprt {
+    double lower;
+    double upper;
+
+    Sprt(double alpha, double beta);
+};
+
+} // namespace Mondfisch::Match
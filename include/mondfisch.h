@@ -0,0 +1,74 @@
+#pragma once
+
+/* C interface of the engine for use from other languages, a thin layer over Mondfisch::Api.
+ * No exception leaves it: functions returning int return 0 on failure and 1 on success. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MF_MAX_PV 128
+/* uci notation with the terminating zero */
+#define MF_MOVE_SIZE 6
+
+typedef struct mf_engine mf_engine;
+
+/* status of a search result, without a legal move bestmove is "0000" and the pv is empty */
+#define MF_STATUS_OK 0
+#define MF_STATUS_CHECKMATE 1
+#define MF_STATUS_STALEMATE 2
+
+/* 0 means no limit */
+typedef struct {
+    uint32_t depth;
+    uint64_t nodes;
+    uint64_t movetime; /* milliseconds */
+    uint32_t mate;     /* mate in moves */
+} mf_limits;
+
+typedef struct {
+    int32_t status; /* MF_STATUS_* */
+    int32_t score;  /* centipawns from the view of the side to move */
+    int32_t mate;   /* moves until mate, negative if the side to move is mated, 0 without mate */
+    uint32_t depth;
+    uint32_t seldepth;
+    uint64_t nodes;
+    int64_t time; /* milliseconds */
+    char bestmove[MF_MOVE_SIZE];
+    uint32_t pv_length;
+    char pv[MF_MAX_PV][MF_MOVE_SIZE];
+} mf_result;
+
+/* called from the searching thread for every completed iteration */
+typedef void (*mf_info_callback)(const mf_result *info, void *user_data);
+
+/* null if the engine can not be created */
+mf_engine *mf_engine_create(uint32_t hash_mb);
+void mf_engine_destroy(mf_engine *engine);
+
+int mf_new_game(mf_engine *engine);
+int mf_set_hash(mf_engine *engine, uint32_t mb);
+
+/* startpos if fen is null, moves in uci notation. Returns 0 if the fen is not valid, the
+ * position stays unchanged then, or if a move is not legal. Missing castling, en passant and
+ * move counter fields default to "- - 0 1". */
+int mf_set_position(mf_engine *engine, const char *fen, const char *const *moves, size_t count);
+
+/* searches until a limit is reached, callback may be null */
+int mf_search(mf_engine *engine, const mf_limits *limits, mf_info_callback callback,
+              void *user_data, mf_result *result);
+/* searches in a background thread until mf_stop or a limit, mf_wait returns the result */
+int mf_start(mf_engine *engine, const mf_limits *limits, mf_info_callback callback,
+             void *user_data);
+void mf_stop(mf_engine *engine);
+int mf_wait(mf_engine *engine, mf_result *result);
+
+/* static evaluation in centipawns from the view of the side to move, 0 on failure */
+int32_t mf_evaluate(mf_engine *engine);
+
+#ifdef __cplusplus
+}
+#endif
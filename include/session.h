@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Mondfisch::Session {
+
+// One line of a session recorded with --record, direction '<' for input and '>' for output.
+struct Event {
+    int64_t micros;
+    char direction;
+    std::string line;
+};
+
+// the events of a session file, empty if it can not be read
+std::vector<Event> load(const std::string &filename);
+
+// a go that searches and ends with a bestmove, unlike go perft
+bool is_search(std::string_view line);
+
+// Milliseconds every searching go took until its bestmove, in the order of the gos, -1 for a go
+// without one. Input is stamped on arrival, so gos queued during a search are recorded before
+// the bestmoves of the searches ahead of them. The k-th go belongs to the k-th bestmove and a
+// queued go starts once the bestmove before it is sent.
+std::vector<double> recorded_latencies(const std::vector<Event> &events);
+
+} // namespace Mondfisch::Session
@@ -2,19 +2,27 @@
 
 #include "engine_search.h"
 #include "game.h"
+#include "logger.h"
+#include <array>
+#include <chrono>
 #include <cmath>
-#include <fstream>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <format>
 #include <iostream>
+#include <iterator>
+#include <mutex>
 #include <print>
-#include <ranges>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 namespace Mondfisch {
 constexpr std::string name = "Mondfisch";
 constexpr std::string author = "cryptocore";
 
-inline bool debug = false;
-
 enum class OptionType {
     SPIN,
     CHECK,
@@ -57,6 +65,8 @@ struct TimeManagement {
     int64_t movetime = -1;
 };
 
+constexpr uint64_t rng_seed = 0x6d6f6e6466697363;
+
 struct UciEngine {
     Game game{};
     Search::TranspositionTable table{};
@@ -64,6 +74,17 @@ struct UciEngine {
     TimeManagement timeValues{};
     int32_t depth = 0;
     uint8_t kBest = 1;
+    // empty logs to stderr, but only in debug mode
+    std::string logFile;
+    LogLevel logLevel = LogLevel::INFO;
+    // debug on logs everything
+    bool debug = false;
+    uint64_t rng = rng_seed;
+    // result of the last go
+    Search::SearchResult lastResult{};
+    // the last position command, later commands that extend it only play the new moves
+    std::string positionBase;
+    std::vector<std::string> positionMoves;
 
     UciEngine() {
         table.setsize(16);
@@ -73,43 +94,127 @@ struct UciEngine {
 
     void think();
     void new_uci_game();
+    void set_position(std::stringstream &ss);
     void loop();
+    // executes one command, false once the engine should quit
+    bool handle(const std::string &line);
+    void set_option(const std::string &name, const std::string &value);
+    void configure_logger();
     uint64_t calc_time();
 };
 
-struct Logger {
-    std::string filename;
-    std::ofstream file;
+// enough for the longest pv and all numbers of an info line, or the counters of SEARCH_STATS
+constexpr size_t info_buffer_size = 256 + Search::max_ply * (max_notation_length + 1) +
+                                    (Search::collect_stats ? 1024 + Search::max_depth * 8 : 0);
+// root moves are only announced with currmove once a search runs this long
+constexpr std::chrono::milliseconds currmove_delay{1000};
 
-    void log(const std::string &s) {
-        if (!debug) {
-            return;
+// Every message is formatted into one reusable buffer and handed to stdout with a single write.
+// A session can be recorded to a file (--record), every line the engine reads or writes is
+// stored as "<microseconds since start> <direction> <line>" with direction '<' for input and
+// '>' for output. tools/replay.cpp feeds such a session back to the engine. Input is read on its
+// own thread and stamped on arrival, also while a search blocks the command loop, output is
+// stamped when it is written and every report is flushed right after its last line.
+//
+// In json mode (option JsonOutput or the --json flag) search output is written as one json object
+// per line instead of info lines. The replies the protocol waits for (uciok, readyok, bestmove)
+// stay plain text, every line starting with '{' is an event:
+//   {"event": "iteration", "depth", "seldepth", "score", "nodes", "nps", "time", "hashfull", "pv"}
+//   {"event": "stats", "depth", "nodes", "hashfull", "counters"}
+//   {"event": "multipv", "rank", "move", "score", "bound"}
+//   {"event": "result", "bestmove", "depth", "score", "nodes", "nps", "time"}
+//   {"event": "bench_position", "position", "bestmove", "nodes"}
+//   {"event": "bench", "variant", "time", "nodes", "nps", "counters"}
+// score is {"cp": centipawns} or {"mate": moves}, time in milliseconds, hashfull in permill and
+// pv a list of moves in uci notation. stats follows every iteration, counters holds the
+// SearchStats of the search so far and is only present in builds with SEARCH_STATS. multipv lists
+// the candidates of the final iteration best first, only the first score is exact, the others
+// are upper bounds. result comes right before bestmove, which may be another candidate. The bench
+// command reports every position with bench_position and ends with bench, its counters are those
+// of all positions.
+struct IO {
+    inline static std::string buffer = []() {
+        std::string s;
+        s.reserve(info_buffer_size);
+        return s;
+    }();
+    inline static bool json = false;
+    // output is discarded if null
+    inline static std::FILE *out = stdout;
+    inline static std::FILE *session = nullptr;
+    inline static std::chrono::steady_clock::time_point sessionStart{};
+    // the input thread and the command loop both record lines
+    inline static std::mutex sessionMutex;
+    // lines read by the input thread that the command loop has not taken yet
+    inline static std::deque<std::string> input;
+    inline static bool inputClosed = false;
+    inline static std::mutex inputMutex;
+    inline static std::condition_variable inputReady;
+    inline static std::once_flag inputStarted;
+
+    static bool record(const std::string &filename) {
+        session = std::fopen(filename.c_str(), "w");
+        sessionStart = std::chrono::steady_clock::now();
+        return session != nullptr;
+    }
+
+    static void recordLine(char direction, std::string_view line) {
+        std::lock_guard lock(sessionMutex);
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - sessionStart)
+                          .count();
+        std::array<char, 32> prefix;
+        auto result = std::format_to_n(prefix.data(), prefix.size(), "{} {} ", micros, direction);
+        std::fwrite(prefix.data(), 1, result.size, session);
+        std::fwrite(line.data(), 1, line.size(), session);
+        std::fputc('\n', session);
+    }
+
+    template <typename... Args>
+    static void format(std::format_string<Args...> fmt, Args &&...args) {
+        std::format_to(std::back_inserter(buffer), fmt, std::forward<Args>(args)...);
+    }
+
+    // Terminates the message in the buffer and writes it. A message that ends a group of lines,
+    // e.g. the last line of an iteration report, flushes them, so nothing waits in the stdio
+    // buffer for later output. How often lines are sent is limited by the search, not here.
+    static void write(bool flush) {
+        logger.debug(">> {}", buffer);
+        if (session != nullptr) {
+            recordLine('>', buffer);
+        }
+        buffer.push_back('\n');
+        if (out != nullptr) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
         }
-        std::cerr << s << std::endl;
-        if (!filename.empty()) {
-            file << s << std::endl;
+        buffer.clear();
+        if (flush) {
+            IO::flush();
         }
     }
 
-    void init() { file.open(filename, std::ios_base::app); }
-    void close() {
-        file.flush();
-        file.close();
+    static void flush() {
+        if (out != nullptr) {
+            std::fflush(out);
+        }
+        if (session != nullptr) {
+            std::fflush(session);
+        }
     }
-};
 
-struct IO {
-    static void send(const std::string &s) {
-        std::cout << s << std::endl;
-        std::cout.flush();
+    static void send(std::string_view s, bool flush = false) {
+        buffer.append(s);
+        write(flush);
     }
 
     static void sendId() {
-        send(std::format("id name {}", name));
-        send(std::format("id author {}", author));
+        format("id name {}", name);
+        write(false);
+        format("id author {}", author);
+        write(false);
     }
 
-    static void sendUciOk() { send("uciok"); }
+    static void sendUciOk() { send("uciok", true); }
 
     static void sendOption(const Option &option) {
         std::string res = "option name ";
@@ -146,34 +251,243 @@ struct IO {
             .max = "256",
             .defaultStr = "1",
         });
+        Search::SearchParams params{};
+        sendOption(Option{
+            .name = "LmrBase",
+            .type = OptionType::SPIN,
+            .min = "0",
+            .max = "300",
+            .defaultStr = std::to_string(params.lmrBase),
+        });
+        sendOption(Option{
+            .name = "LmrDivisor",
+            .type = OptionType::SPIN,
+            .min = "100",
+            .max = "1000",
+            .defaultStr = std::to_string(params.lmrDivisor),
+        });
+        std::string variants;
+        for (const auto &variant : Search::search_variants) {
+            variants += std::format("{}{}", variants.empty() ? "" : " var ", variant.name);
+        }
+        sendOption(Option{
+            .name = "SearchVariant",
+            .type = OptionType::COMBO,
+            .var = variants,
+            .defaultStr = std::string(params.variantName()),
+        });
+        sendOption(Option{
+            .name = "LogFile",
+            .type = OptionType::STRING,
+            .defaultStr = "<empty>",
+        });
+        sendOption(Option{
+            .name = "LogLevel",
+            .type = OptionType::COMBO,
+            .var = "debug var info var warn var error var none",
+            .defaultStr = "info",
+        });
+        sendOption(Option{
+            .name = "JsonOutput",
+            .type = OptionType::CHECK,
+            .defaultStr = json ? "true" : "false",
+        });
     }
 
-    static void sendReadyOk() { send("readyok"); }
+    static void sendReadyOk() { send("readyok", true); }
+
+    static void sendString(std::string_view s) {
+        format("info string {}", s);
+        write(true);
+    }
 
     static void sendBestMove(Move move) {
-        send(std::format("bestmove {}", move.toSimpleNotation()));
+        buffer.append("bestmove ");
+        appendMove(move);
+        write(true);
+    }
+
+    static void appendMove(Move move) {
+        std::array<char, max_notation_length> notation;
+        buffer.append(notation.data(), move.writeSimpleNotation(notation.data()));
+    }
+
+    static void sendCurrMove(uint32_t depth, Move move, uint32_t number) {
+        format("info depth {} currmove ", depth);
+        appendMove(move);
+        format(" currmovenumber {}", number);
+        write(true);
+    }
+
+    static void appendJsonMove(Move move) {
+        buffer.push_back('"');
+        appendMove(move);
+        buffer.push_back('"');
     }
 
-    static void sendSearchInfo(Search::SearchResult &result, uint32_t hashfull) {
-        uint32_t nps = result.nodes * 1000.0f / result.elapsed;
-        std::string pvs = "";
-        for (auto [i, move] : std::views::enumerate(result.pv)) {
+    static void appendJsonScore(Search::Score score) {
+        if (Search::is_mate(score)) {
+            format("{{\"mate\": {}}}", Search::mate_in(score));
+        } else {
+            format("{{\"cp\": {}}}", score);
+        }
+    }
+
+    static uint64_t nps(const Search::SearchResult &result) {
+        return result.elapsed > 0 ? result.nodes * 1000 / result.elapsed : 0;
+    }
+
+    static void sendSearchInfoJson(const Search::SearchResult &result, uint32_t hashfull) {
+        format("{{\"event\": \"iteration\", \"depth\": {}, \"seldepth\": {}, \"score\": ",
+               result.depth, result.selDepth);
+        appendJsonScore(result.score);
+        format(", \"nodes\": {}, \"nps\": {}, \"time\": {}, \"hashfull\": {}, \"pv\": [",
+               result.nodes, nps(result), result.elapsed, hashfull);
+        for (size_t i = 0; i < result.pvLength; i++) {
             if (i > 0) {
-                pvs += " ";
+                buffer.append(", ");
             }
-            pvs += move.toSimpleNotation();
+            appendJsonMove(result.pv[i]);
+        }
+        buffer.append("]}");
+        write(false);
+    }
+
+    // the counters are only written in builds that collect them
+    static void sendStatsJson(const Search::SearchResult &result, uint32_t hashfull,
+                              const Search::SearchStats &stats) {
+        format("{{\"event\": \"stats\", \"depth\": {}, \"nodes\": {}, \"hashfull\": {}",
+               result.depth, result.nodes, hashfull);
+        if constexpr (Search::collect_stats) {
+            buffer.append(", \"counters\": ");
+            stats.appendJsonTo(buffer);
+        }
+        buffer.push_back('}');
+        write(false);
+    }
+
+    static void sendStats(const Search::SearchStats &stats, uint32_t depth, uint64_t nodes) {
+        buffer.append("info string stats ");
+        stats.appendTo(buffer, depth, nodes);
+        write(true);
+    }
+
+    static void sendMultiPvJson(uint32_t rank, const ScoreMove &move) {
+        format("{{\"event\": \"multipv\", \"rank\": {}, \"move\": ", rank);
+        appendJsonMove(move.move);
+        buffer.append(", \"score\": ");
+        appendJsonScore(move.score);
+        format(", \"bound\": \"{}\"}}", rank == 1 ? "exact" : "upper");
+        write(false);
+    }
+
+    static void sendResultJson(const Search::SearchResult &result, Move best) {
+        buffer.append("{\"event\": \"result\", \"bestmove\": ");
+        appendJsonMove(best);
+        format(", \"depth\": {}, \"score\": ", result.depth);
+        appendJsonScore(result.score);
+        format(", \"nodes\": {}, \"nps\": {}, \"time\": {}}}", result.nodes, nps(result),
+               result.elapsed);
+        write(false);
+    }
+
+    static void sendSearchInfo(const Search::SearchResult &result, uint32_t hashfull) {
+        if (json) {
+            sendSearchInfoJson(result, hashfull);
+            return;
         }
-        std::string score;
+        format("info depth {} seldepth {} score ", result.depth, result.selDepth);
         if (Search::is_mate(result.score)) {
-            score = std::format("mate {}", ((Search::mate - std::abs(result.score)) + 1) / 2);
+            format("mate {}", Search::mate_in(result.score));
         } else {
-            score = std::format("cp {}", result.score);
+            format("cp {}", result.score);
         }
-        send(std::format("info depth {} score {} time {} nodes {} nps {} pv {} hashfull {}",
-                         result.depth, score, result.elapsed, result.nodes, nps, pvs, hashfull));
+        format(" nodes {} nps {} time {} hashfull {}", result.nodes, nps(result), result.elapsed,
+               hashfull);
+        if (result.pvLength > 0) {
+            buffer.append(" pv");
+        }
+        for (Move move : result.pvMoves()) {
+            buffer.push_back(' ');
+            appendMove(move);
+        }
+        write(false);
+    }
+
+    static void sendBenchPosition(uint32_t number, size_t count, Move best, uint64_t nodes) {
+        if (json) {
+            format("{{\"event\": \"bench_position\", \"position\": {}, \"bestmove\": ", number);
+            appendJsonMove(best);
+            format(", \"nodes\": {}}}", nodes);
+        } else {
+            format("Position {:>2}/{}: bestmove ", number, count);
+            appendMove(best);
+            format(" nodes {}", nodes);
+        }
+        write(false);
     }
 
-    static bool recv(std::string &s) { return static_cast<bool>(std::getline(std::cin, s)); }
+    // counters as in sendStatsJson
+    static void sendBenchResult(std::string_view variant, int64_t elapsed, uint64_t nodes,
+                                uint64_t nps, const Search::SearchStats &stats) {
+        if (json) {
+            format("{{\"event\": \"bench\", \"variant\": \"{}\", \"time\": {}, \"nodes\": {}, "
+                   "\"nps\": {}",
+                   variant, elapsed, nodes, nps);
+            if constexpr (Search::collect_stats) {
+                buffer.append(", \"counters\": ");
+                stats.appendJsonTo(buffer);
+            }
+            buffer.push_back('}');
+            write(true);
+            return;
+        }
+        send("");
+        send("===========================");
+        if (variant != Search::search_variants[0].name) {
+            format("Search variant  : {}", variant);
+            write(false);
+        }
+        format("Total time (ms) : {}", elapsed);
+        write(false);
+        format("Nodes searched  : {}", nodes);
+        write(false);
+        format("Nodes/second    : {}", nps);
+        write(!Search::collect_stats);
+        if constexpr (Search::collect_stats) {
+            buffer.append("Search stats    : ");
+            stats.appendJsonTo(buffer);
+            write(true);
+        }
+    }
+
+    static void readInput() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (session != nullptr) {
+                recordLine('<', line);
+            }
+            std::lock_guard lock(inputMutex);
+            input.push_back(std::move(line));
+            inputReady.notify_one();
+        }
+        std::lock_guard lock(inputMutex);
+        inputClosed = true;
+        inputReady.notify_one();
+    }
+
+    // the next line of stdin, false once it is closed
+    static bool recv(std::string &s) {
+        std::call_once(inputStarted, []() { std::thread(readInput).detach(); });
+        std::unique_lock lock(inputMutex);
+        inputReady.wait(lock, []() { return !input.empty() || inputClosed; });
+        if (input.empty()) {
+            return false;
+        }
+        s = std::move(input.front());
+        input.pop_front();
+        return true;
+    }
 };
 
 } // namespace Mondfisch
@@ -0,0 +1,337 @@
+#include "api.h"
+#include "evaluation.h"
+#include "mondfisch.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <format>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Mondfisch::Api {
+
+namespace {
+std::once_flag constants;
+
+bool is_legal(Game &game, std::string_view notation) {
+    MoveList moves;
+    game.legal_moves(moves);
+    return std::any_of(moves.begin(), moves.end(), [&](const ScoreMove &move) {
+        std::array<char, max_notation_length> buffer;
+        char *end = move.move.writeSimpleNotation(buffer.data());
+        return std::string_view(buffer.data(), end - buffer.data()) == notation;
+    });
+}
+bool consists_of(std::string_view field, std::string_view chars) {
+    return std::all_of(field.begin(), field.end(), [&](char c) { return chars.contains(c); });
+}
+
+bool is_number(std::string_view field) {
+    // at most 4 digits, so that the conversion can not overflow
+    return !field.empty() && field.size() <= 4 && consists_of(field, "0123456789");
+}
+
+// Game::loadFen trusts its input. Checks the fields it reads and completes a fen without the
+// optional castling, en passant and move counter fields, false if the fen can not be loaded.
+bool check_fen(std::string_view fen, std::string &checked) {
+    std::stringstream ss{std::string(fen)};
+    std::array<std::string, 6> fields{"", "", "-", "-", "0", "1"};
+    for (size_t i = 0; i < fields.size() && ss >> fields[i]; i++) {
+    }
+    std::string extra;
+    if (fields[1].empty() || ss >> extra) {
+        return false;
+    }
+    const auto &[board, side, castling, enPassant, halfmove, fullmoves] = fields;
+
+    std::array<uint32_t, 2> kings{};
+    uint32_t rank = 0;
+    uint32_t file = 0;
+    for (char c : board) {
+        if (c == '/') {
+            if (file != 8) {
+                return false;
+            }
+            rank++;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else if (std::string_view("KQRBNPkqrbnp").contains(c)) {
+            // pawns on the first or last rank have no moves the generator knows about
+            if ((c == 'P' || c == 'p') && (rank == 0 || rank == 7)) {
+                return false;
+            }
+            kings[c == 'k'] += c == 'K' || c == 'k';
+            file++;
+        } else {
+            return false;
+        }
+        if (file > 8) {
+            return false;
+        }
+    }
+    if (rank != 7 || file != 8 || kings[0] != 1 || kings[1] != 1) {
+        return false;
+    }
+    if (side != "w" && side != "b") {
+        return false;
+    }
+    if (castling != "-" && (castling.size() > 4 || !consists_of(castling, "KQkq"))) {
+        return false;
+    }
+    if (enPassant != "-" &&
+        (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' ||
+         enPassant[1] != (side == "w" ? '6' : '3'))) {
+        return false;
+    }
+    if (!is_number(halfmove) || !is_number(fullmoves)) {
+        return false;
+    }
+    checked = std::format("{} {} {} {} {} {}", board, side, castling, enPassant, halfmove,
+                          fullmoves);
+    return true;
+}
+} // namespace
+
+Engine::Engine(uint32_t hashMb) {
+    std::call_once(constants, initConstants);
+    table.setsize(hashMb);
+    newGame();
+}
+
+Engine::~Engine() {
+    stop();
+    wait();
+}
+
+void Engine::newGame() {
+    wait();
+    game.reset();
+    game.loadStartingPos();
+    ctx.reset();
+    ctx.table = &table;
+    table.clear();
+}
+
+void Engine::setHash(uint32_t mb) {
+    wait();
+    table.setsize(mb);
+}
+
+bool Engine::setOption(std::string_view name, std::string_view value) {
+    wait();
+    int32_t number = std::strtol(std::string(value).c_str(), nullptr, 10);
+    if (name == "Hash") {
+        table.setsize(std::max(number, 1));
+        return true;
+    }
+    if (name == "SearchVariant") {
+        return ctx.params.setVariant(value);
+    }
+    return ctx.params.set(name, number);
+}
+
+bool Engine::setPosition(std::string_view fen, std::span<const std::string_view> moves) {
+    wait();
+    std::string checked;
+    if (fen.empty()) {
+        game.loadStartingPos();
+    } else if (check_fen(fen, checked)) {
+        game.loadFen(checked);
+    } else {
+        return false;
+    }
+    return std::all_of(moves.begin(), moves.end(),
+                       [&](std::string_view move) { return playMove(move); });
+}
+
+bool Engine::playMove(std::string_view move) {
+    wait();
+    if (!is_legal(game, move)) {
+        return false;
+    }
+    game.playMove(move);
+    return true;
+}
+
+Search::SearchResult Engine::search(const Limits &limits, InfoCallback callback) {
+    wait();
+    ctx.startTimer();
+    run(limits, std::move(callback));
+    return result;
+}
+
+void Engine::start(const Limits &limits, InfoCallback callback) {
+    wait();
+    // started here so that a stop right after start is not lost
+    ctx.startTimer();
+    searcher = std::thread([this, limits, callback = std::move(callback)]() mutable {
+        run(limits, std::move(callback));
+    });
+}
+
+void Engine::run(const Limits &limits, InfoCallback callback) {
+    ctx.nodeLimit = limits.nodes;
+    ctx.thinkingTime = limits.movetime;
+    ctx.mateLimit = limits.mate;
+    ctx.report = static_cast<bool>(callback);
+    ctx.onIteration = std::move(callback);
+    uint32_t depth = limits.depth > 0 ? std::min<uint32_t>(limits.depth, Search::max_depth)
+                                      : Search::max_depth;
+    result = Search::iterative_deepening(ctx, game, depth);
+    ctx.onIteration = nullptr;
+}
+
+void Engine::stop() { ctx.stop = true; }
+
+const Search::SearchResult &Engine::wait() {
+    if (searcher.joinable()) {
+        searcher.join();
+    }
+    return result;
+}
+
+Search::Score Engine::evaluate() {
+    wait();
+    return signedColor[game.color] * Evaluation::tapered_eval(game);
+}
+
+} // namespace Mondfisch::Api
+
+struct mf_engine {
+    Mondfisch::Api::Engine engine;
+
+    explicit mf_engine(uint32_t hashMb) : engine(hashMb) {}
+};
+
+namespace {
+
+static_assert(MF_MAX_PV >= Mondfisch::Search::max_ply);
+static_assert(MF_MOVE_SIZE > Mondfisch::max_notation_length);
+
+void write_move(char *out, Mondfisch::Move move) { *move.writeSimpleNotation(out) = '\0'; }
+
+void to_c_result(const Mondfisch::Search::SearchResult &result, mf_result *out) {
+    bool mate = Mondfisch::Search::is_mate(result.score);
+    out->status = result.bestMove != Mondfisch::Move{} ? MF_STATUS_OK
+                  : mate                               ? MF_STATUS_CHECKMATE
+                                                       : MF_STATUS_STALEMATE;
+    out->score = result.score;
+    out->mate = mate ? Mondfisch::Search::mate_in(result.score) : 0;
+    out->depth = result.depth;
+    out->seldepth = result.selDepth;
+    out->nodes = result.nodes;
+    out->time = result.elapsed;
+    write_move(out->bestmove, result.bestMove);
+    out->pv_length = result.pvLength;
+    for (uint32_t i = 0; i < result.pvLength; i++) {
+        write_move(out->pv[i], result.pv[i]);
+    }
+}
+
+Mondfisch::Api::Limits to_limits(const mf_limits *limits) {
+    if (limits == nullptr) {
+        return {};
+    }
+    return Mondfisch::Api::Limits{
+        .depth = limits->depth,
+        .nodes = limits->nodes,
+        .movetime = limits->movetime,
+        .mate = limits->mate,
+    };
+}
+
+Mondfisch::Api::InfoCallback to_callback(mf_info_callback callback, void *userData) {
+    if (callback == nullptr) {
+        return {};
+    }
+    return [callback, userData](const Mondfisch::Search::SearchResult &result) {
+        mf_result info;
+        to_c_result(result, &info);
+        callback(&info, userData);
+    };
+}
+
+// exceptions must not leave the c interface, they become the error value
+template <typename T, typename Body> T guarded(T error, Body &&body) noexcept {
+    try {
+        return body();
+    } catch (...) {
+        return error;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+mf_engine *mf_engine_create(uint32_t hash_mb) {
+    return guarded(static_cast<mf_engine *>(nullptr), [&]() { return new mf_engine(hash_mb); });
+}
+
+void mf_engine_destroy(mf_engine *engine) {
+    guarded(0, [&]() {
+        delete engine;
+        return 1;
+    });
+}
+
+int mf_new_game(mf_engine *engine) {
+    return guarded(0, [&]() {
+        engine->engine.newGame();
+        return 1;
+    });
+}
+
+int mf_set_hash(mf_engine *engine, uint32_t mb) {
+    return guarded(0, [&]() {
+        engine->engine.setHash(mb);
+        return 1;
+    });
+}
+
+int mf_set_position(mf_engine *engine, const char *fen, const char *const *moves, size_t count) {
+    return guarded(0, [&]() {
+        std::vector<std::string_view> list(moves, moves + count);
+        return int(engine->engine.setPosition(fen == nullptr ? "" : fen, list));
+    });
+}
+
+int mf_search(mf_engine *engine, const mf_limits *limits, mf_info_callback callback,
+              void *user_data, mf_result *result) {
+    return guarded(0, [&]() {
+        auto searchResult =
+            engine->engine.search(to_limits(limits), to_callback(callback, user_data));
+        if (result != nullptr) {
+            to_c_result(searchResult, result);
+        }
+        return 1;
+    });
+}
+
+int mf_start(mf_engine *engine, const mf_limits *limits, mf_info_callback callback,
+             void *user_data) {
+    return guarded(0, [&]() {
+        engine->engine.start(to_limits(limits), to_callback(callback, user_data));
+        return 1;
+    });
+}
+
+void mf_stop(mf_engine *engine) { engine->engine.stop(); }
+
+int mf_wait(mf_engine *engine, mf_result *result) {
+    return guarded(0, [&]() {
+        const auto &searchResult = engine->engine.wait();
+        if (result != nullptr) {
+            to_c_result(searchResult, result);
+        }
+        return 1;
+    });
+}
+
+int32_t mf_evaluate(mf_engine *engine) {
+    return guarded(0, [&]() { return int32_t(engine->engine.evaluate()); });
+}
+}
@@ -0,0 +1,90 @@
+#include "batch.h"
+#include "evaluation.h"
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <ranges>
+
+namespace Mondfisch::Batch {
+
+namespace {
+bool is_number(std::string_view s) {
+    return !s.empty() && std::ranges::all_of(s, [](char c) { return std::isdigit(c); });
+}
+} // namespace
+
+std::string epd_to_fen(std::string_view epd) {
+    std::vector<std::string_view> fields;
+    size_t pos = 0;
+    while (fields.size() < 6 && pos < epd.size()) {
+        size_t start = epd.find_first_not_of(' ', pos);
+        if (start == std::string_view::npos) {
+            break;
+        }
+        size_t end = std::min(epd.find_first_of(" ;", start), epd.size());
+        fields.push_back(epd.substr(start, end - start));
+        pos = end;
+    }
+
+    std::string fen;
+    for (size_t i = 0; i < std::min<size_t>(fields.size(), 4); i++) {
+        fen += i > 0 ? " " : "";
+        fen += fields[i];
+    }
+    if (fields.size() >= 6 && is_number(fields[4]) && is_number(fields[5])) {
+        fen += std::format(" {} {}", fields[4], fields[5]);
+    } else {
+        fen += " 0 1";
+    }
+    return fen;
+}
+
+Worker::Worker(uint32_t hash, const Search::SearchParams &params) {
+    table.setsize(hash);
+    ctx.report = false;
+    ctx.params = params;
+}
+
+void Worker::load(const std::string &fen) {
+    game.loadFen(fen);
+    ctx.reset();
+    ctx.table = &table;
+    table.clear();
+}
+
+Summary evaluate(std::span<const std::string> lines, const Options &options,
+                 std::vector<Result> &results) {
+    results.assign(lines.size(), Result{});
+    uint32_t depth = options.depth > 0 ? std::min<uint32_t>(options.depth, Search::max_depth)
+                                       : Search::max_depth;
+
+    auto start = std::chrono::steady_clock::now();
+    parallel_for(
+        lines.size(), options.threads, [&]() { return Worker(options.hash); },
+        [&](Worker &worker, size_t i) {
+            std::string fen = epd_to_fen(lines[i]);
+            if (!options.searches()) {
+                worker.game.loadFen(fen);
+                results[i].score =
+                    signedColor[worker.game.color] * Evaluation::tapered_eval(worker.game);
+                return;
+            }
+            worker.load(fen);
+            worker.ctx.nodeLimit = options.nodes;
+            worker.ctx.startTimer();
+            auto result = Search::iterative_deepening(worker.ctx, worker.game, depth);
+            results[i] = {result.score, result.bestMove, worker.ctx.nodes};
+        });
+    auto end = std::chrono::steady_clock::now();
+
+    Summary summary{};
+    for (const Result &result : results) {
+        summary.nodes += result.nodes;
+    }
+    summary.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    summary.positionsPerSecond =
+        lines.size() / std::max(std::chrono::duration<double>(end - start).count(), 1e-9);
+    return summary;
+}
+
+} // namespace Mondfisch::Batch
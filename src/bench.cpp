@@ -0,0 +1,104 @@
+#include "bench.h"
+#include "batch.h"
+#include "engine_search.h"
+#include "game.h"
+#include "uci.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Mondfisch::Bench {
+
+const std::array<std::string_view, 50> positions{
+    "r1bq1r1k/p1pnbpp1/1p2p3/6p1/3PB3/5N2/PPPQ1PPP/2KR3R w - - 0 1",
+    "r1b2rk1/1p1nbppp/pq1p4/3B4/P2NP3/2N1p3/1PP3PP/R2Q1R1K w - - 0 1",
+    "r2r1k2/p3qpp1/1p1ppn1p/n5B1/P1PNbP2/2P3Q1/4B1PP/4RRK1 w - - 0 1",
+    "2rr3k/2qnbppp/p1n1p3/1p1pP3/3P1N2/1Q1BBP2/PP3P1P/1KR3R1 w - - 0 1",
+    "3q1r1k/1b3ppp/p1n5/1p1pPB2/2rP4/P6N/1P2Q1PP/R4RK1 w - - 0 1",
+    "r1b1k2r/1p1pppb1/p5pp/3P4/q2p1B2/3P1Q2/PPP2PPP/R3R1K1 w kq - 0 1",
+    "R4bk1/2Bbp2p/2p2pp1/1rPp4/3P4/4P2P/4BPPK/1q1Q4 w - - 0 1",
+    "r1r3k1/p3bppp/2bp3Q/q2pP1P1/1p1BP3/8/PPP1B2P/2KR2R1 w - - 0 1",
+    "b2rk1r1/p3q3/2p5/3nPR2/3P2pp/1R1B2P1/P1Q2P2/6K1 w - - 0 1",
+    "r2q3r/1p1bbQ2/4p1Bk/3pP3/1n1P1P1p/pP6/Pn4PP/R1B1R1K1 w - - 0 1",
+    "1r2brk1/4n1p1/4p2p/p2pP1qP/2pP1NP1/P1Q1BK2/2P4R/6R1 b - - 0 1",
+    "1rb2k1r/2q2pp1/p2b3p/2n3B1/2QN4/3B4/PpP3PP/1K2R2R w - - 0 1",
+    "5rk1/1pp3p1/3ppr1p/pP2p2n/4P2q/P2PQ2P/2P1NPP1/R4RK1 b - - 0 1",
+    "r4rk1/1b1n1pb1/3p2p1/1p1Pq1Bp/2p1P3/2P2RNP/1PBQ2P1/5R1K w - - 0 1",
+    "2kr2r1/ppq1bp1p/4pn2/2p1n1pb/4P1P1/2P2N1P/PPBNQP2/R1B1R1K1 b - - 0 1",
+    "8/3r4/pr1Pk1p1/8/7P/6P1/3R3K/5R2 w - - 0 1",
+    "2r4k/2P3pp/6n1/1p1B4/1B1N1p2/P6b/5q2/1K1RR3 b - - 0 1",
+    "r1q2rk1/ppnbbpp1/n4P1p/4P3/3p4/2N1B1PP/PP4BK/R2Q1R2 w - - 0 1",
+    "1R6/5p1k/4bPpp/3pN3/2pP1P1P/2r5/6PK/8 w - - 0 1",
+    "3q1rk1/pr1b1p1p/1bp2p2/2ppP3/8/2P1BN2/PPQ3PP/R4RK1 w - - 0 1",
+    "1r4k1/1pnq2pp/1p3p2/rP1ppP2/1R2P3/PQ1P1R1P/6PK/2B5 w - - 0 1",
+    "8/6p1/P1b1pp2/2p1p3/1k4P1/3PP3/1PK5/5B2 w - - 0 1",
+    "r5n1/p1p1q2k/4b2p/3pB3/3PP1pP/8/PPPQ2P1/5RK1 w - - 0 1",
+    "2b2rk1/r3q1pp/1nn1p3/3pP1NP/p1pP2Q1/2P1N3/1P1KBP2/R5R1 w - - 0 1",
+    "rnb3k1/p3qpr1/2p1p3/2NP3p/1pP3p1/3BQ3/P4PP1/4RRK1 w - - 0 1",
+    "r3r1k1/p3bppp/q1b2n2/5Q2/1p1B4/1BNR4/PPP3PP/2K2R2 w - - 0 1",
+    "2bq1rk1/rpb2p2/2p1p1p1/p1N3Np/P2P1P1P/1Q2R1P1/1P3P2/3R2K1 w - - 0 1",
+    "3q1r1k/2r2pp1/p6p/1pbppP1N/3pP1PP/3P1Q2/PPP4R/5RK1 w - - 0 1",
+    "1q6/6k1/5Np1/1r4Pp/2p4P/2Nrb3/PP6/KR5Q b - - 0 1",
+    "b2rk3/r4p2/p3p3/P3Q1Np/2Pp3P/8/6P1/6K1 w - - 0 1",
+    "2kr1b1r/1pp1ppp1/p7/q2P3n/2BB1pb1/2NQ4/P1P1N3/1R3RK1 w - - 0 1",
+    "r4k2/5Pp1/1n1b2p1/p2p2Pr/1ppP1NqP/8/PPQB1P2/2R1K2R w K - 0 1",
+    "br4k1/1qrnbppp/pp1ppn2/8/NPPBP3/PN3P2/5QPP/2RR1B1K w - - 0 1",
+    "r2q1rk1/ppp2p2/3p1np1/4pNQ1/4P1pP/1PPP4/1P3P2/R3K1R1 w Q - 0 1",
+    "1qb2rk1/3p1pp1/1p6/1pbBp3/r5p1/3QB3/PPP2P1P/2KR2R1 w - - 0 1",
+    "8/6pk/p3p3/2Q1P3/1p2P3/5P1P/5KP1/1q6 w - - 0 1",
+    "1q3r1k/6b1/B6p/2P5/1P1p2pQ/P3r3/6P1/1R1R2K1 b - - 0 1",
+    "r4rk1/p4ppp/qp2p3/b5B1/n1R5/5N2/PP2QPPP/1R4K1 w - - 0 1",
+    "r2q1rk1/4bppp/3pb3/2n1pP2/1p2P1PP/1P3Q2/1BP1N1B1/2KR3R b - - 0 1",
+    "6k1/p6p/1n3pb1/3p2p1/r2NP3/1R5P/3QNPPK/q7 b - - 0 1",
+    "2b1rk2/5p2/p1P5/2p2P2/2p5/7B/P7/2KR4 w - - 0 1",
+    "rn1qr1k1/1p2bppp/p3p3/3pP3/P2P1B2/2RB1Q1P/1P3PP1/R5K1 w - - 0 1",
+    "1k4rr/p1pq2b1/1p6/1P1pp1p1/6n1/2PP2QN/PN1BP1B1/5RK1 b - - 0 1",
+    "1n3rk1/3rbppp/p2p4/4pP2/Ppq1P3/1N2B3/1PP3PP/R2Q1R1K w - - 0 1",
+    "5k2/1p1b1p2/1r6/3Bn2p/p2qPN1P/3p1PK1/P2Q1RP1/8 b - - 0 1",
+    "r1b2rk1/pp2bppp/3p4/q7/3BN1n1/1B3Q2/PPP3PP/R4RK1 w - - 0 1",
+    "2br3r/p1k5/1pp5/4pP2/2P1N1P1/1P2N1K1/P7/4R3 w - - 0 1",
+    "r2qr3/2p1b1pk/p5pp/1p2p3/nP2P1P1/1BP2RP1/P3QPK1/R1B5 w - - 0 1",
+    "1rbq1rk1/p5bp/3p2p1/2pP4/1p1n1BP1/3P3P/PP2N1B1/1R1Q1RK1 b - - 0 1",
+    "k1b4r/1p3p2/pq2pNp1/5n1p/P3QP2/1P1R1BPP/2P5/1K6 b - - 0 1",
+};
+
+struct PositionResult {
+    uint64_t nodes;
+    Move bestMove;
+    Search::SearchStats stats;
+};
+
+BenchResult run(uint32_t depth, uint32_t hash, uint32_t threads,
+               const Search::SearchParams &params) {
+    depth = std::clamp<uint32_t>(depth, 1, Search::max_depth);
+
+    std::vector<PositionResult> results(positions.size());
+
+    auto start = std::chrono::steady_clock::now();
+    Batch::parallel_for(
+        positions.size(), threads, [&]() { return Batch::Worker(hash, params); },
+        [&](Batch::Worker &worker, size_t i) {
+            worker.load(std::string(positions[i]));
+            worker.ctx.startTimer();
+            auto result = Search::iterative_deepening(worker.ctx, worker.game, depth);
+            results[i] = {worker.ctx.nodes, result.bestMove, worker.ctx.stats};
+        });
+    auto end = std::chrono::steady_clock::now();
+
+    BenchResult bench{};
+    Search::SearchStats stats{};
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        IO::sendBenchPosition(i + 1, positions.size(), results[i].bestMove, results[i].nodes);
+        bench.nodes += results[i].nodes;
+        stats += results[i].stats;
+    }
+    bench.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    bench.nps = bench.nodes * 1000 / std::max<int64_t>(bench.elapsed, 1);
+
+    IO::sendBenchResult(params.variantName(), bench.elapsed, bench.nodes, bench.nps, stats);
+    return bench;
+}
+
+} // namespace Mondfisch::Bench
@@ -1,13 +1,38 @@
+#include "bench.h"
 #include "uci.h"
 #include "game.h"
 #include <cstddef>
-#include <cstdlib>
-#include <ctime>
+#include <print>
+#include <string>
 
-int main() {
-    std::srand(time(NULL));
+int main(int argc, char **argv) {
     Mondfisch::initConstants();
 
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        uint32_t depth = argc > 2 ? std::stoul(argv[2]) : Mondfisch::Bench::default_depth;
+        uint32_t hash = argc > 3 ? std::stoul(argv[3]) : Mondfisch::Bench::default_hash;
+        uint32_t threads = argc > 4 ? std::stoul(argv[4]) : Mondfisch::Bench::default_threads;
+        Mondfisch::Search::SearchParams params{};
+        if (argc > 5 && !params.setVariant(argv[5])) {
+            std::print(stderr, "unknown search variant {}\n", argv[5]);
+            return 1;
+        }
+        Mondfisch::Bench::run(depth, hash, threads, params);
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            Mondfisch::IO::json = true;
+        } else if (arg == "--record" && i + 1 < argc) {
+            if (!Mondfisch::IO::record(argv[++i])) {
+                std::print(stderr, "could not open session file {}\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
     Mondfisch::UciEngine engine{};
     engine.loop();
 }
@@ -5,15 +5,24 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <cmath>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <format>
+#include <iterator>
+#include <utility>
 
 namespace Mondfisch::Search {
 
 bool is_mate(Score score) { return std::abs(score) > mate_threshold; }
 
+int32_t mate_in(Score score) {
+    int32_t moves = ((mate - std::abs(score)) + 1) / 2;
+    return score > 0 ? moves : -moves;
+}
+
 void TranspositionTable::setsize(uint32_t mb) {
     size_t entries = (1014 * 1024 * mb) / sizeof(TableEntry);
     size_t pow2 = 1;
@@ -25,72 +34,152 @@ void TranspositionTable::setsize(uint32_t mb) {
 }
 
 uint32_t TranspositionTable::hashFull() const {
+    uint64_t samples = std::min<uint64_t>(1000, table.size());
     uint64_t count = 0;
-    for (auto entry : table) {
-        if (bool(entry.depth)) {
+    for (uint64_t i = 0; i < samples; i++) {
+        if (!table[i].empty()) {
             count++;
         }
     }
-    return count * 1000 / table.size();
+    return count * 1000 / samples;
 }
 
 void TranspositionTable::clear() { memset(&table[0], 0, sizeof(TableEntry) * table.size()); }
 
-int16_t score_to_tt(int16_t score, int ply) {
-    if (score > mate_threshold) {
-        return score + ply;
+SearchStats &SearchStats::operator+=(const SearchStats &other) {
+    qnodes += other.qnodes;
+    ttProbes += other.ttProbes;
+    ttHits += other.ttHits;
+    ttCutoffs += other.ttCutoffs;
+    betaCutoffs += other.betaCutoffs;
+    firstMoveCutoffs += other.firstMoveCutoffs;
+    nullMoveTries += other.nullMoveTries;
+    nullMoveCutoffs += other.nullMoveCutoffs;
+    rfpTries += other.rfpTries;
+    rfpCutoffs += other.rfpCutoffs;
+    razorTries += other.razorTries;
+    razorCutoffs += other.razorCutoffs;
+    futilityPrunes += other.futilityPrunes;
+    lmpPrunes += other.lmpPrunes;
+    iirReductions += other.iirReductions;
+    probcutTries += other.probcutTries;
+    probcutCutoffs += other.probcutCutoffs;
+    lmrTries += other.lmrTries;
+    lmrResearches += other.lmrResearches;
+    pvsResearches += other.pvsResearches;
+    seeCalls += other.seeCalls;
+    evalCalls += other.evalCalls;
+    for (uint32_t i = 0; i < iterationNodes.size(); i++) {
+        iterationNodes[i] += other.iterationNodes[i];
     }
-    if (score < -mate_threshold) {
-        return score - ply;
+    return *this;
+}
+
+double SearchStats::ebf(uint32_t depth) const {
+    if (depth < 2 || iterationNodes[depth - 1] == 0) {
+        return 0;
     }
-    return score;
+    return double(iterationNodes[depth]) / iterationNodes[depth - 1];
+}
+
+double percent(uint64_t part, uint64_t total) { return total > 0 ? 100.0 * part / total : 0; }
+
+void SearchStats::appendTo(std::string &out, uint32_t depth, uint64_t nodes) const {
+    std::format_to(
+        std::back_inserter(out),
+        "qnodes {:.1f}% tthit {:.1f}% ttcut {:.1f}% fhf {:.1f}% null {}/{} rfp {}/{} razor {}/{} "
+        "futility {} lmp {} iir {} probcut {}/{} lmr {}/{} research {} ebf {:.2f} see {} eval {}",
+        percent(qnodes, nodes), percent(ttHits, ttProbes), percent(ttCutoffs, ttProbes),
+        percent(firstMoveCutoffs, betaCutoffs), nullMoveCutoffs, nullMoveTries, rfpCutoffs,
+        rfpTries, razorCutoffs, razorTries, futilityPrunes, lmpPrunes, iirReductions,
+        probcutCutoffs, probcutTries, lmrTries - lmrResearches, lmrTries, pvsResearches,
+        ebf(depth), seeCalls, evalCalls);
 }
 
-int16_t score_from_tt(int16_t score, int ply) {
-    if (score > mate_threshold) {
-        return score - ply;
+void SearchStats::appendJsonTo(std::string &out) const {
+    std::format_to(
+        std::back_inserter(out),
+        "{{\"qnodes\": {}, \"tt_probes\": {}, \"tt_hits\": {}, \"tt_cutoffs\": {}, "
+        "\"beta_cutoffs\": {}, \"first_move_cutoffs\": {}, \"null_move_tries\": {}, "
+        "\"null_move_cutoffs\": {}, \"rfp_tries\": {}, \"rfp_cutoffs\": {}, "
+        "\"razor_tries\": {}, \"razor_cutoffs\": {}, \"futility_prunes\": {}, "
+        "\"lmp_prunes\": {}, \"iir_reductions\": {}, \"probcut_tries\": {}, "
+        "\"probcut_cutoffs\": {}, \"lmr_tries\": {}, \"lmr_researches\": {}, "
+        "\"pvs_researches\": {}, \"see_calls\": {}, \"eval_calls\": {}, \"ebf\": [",
+        qnodes, ttProbes, ttHits, ttCutoffs, betaCutoffs, firstMoveCutoffs, nullMoveTries,
+        nullMoveCutoffs, rfpTries, rfpCutoffs, razorTries, razorCutoffs, futilityPrunes, lmpPrunes,
+        iirReductions, probcutTries, probcutCutoffs, lmrTries, lmrResearches, pvsResearches,
+        seeCalls, evalCalls);
+    for (uint32_t i = 2; i < iterationNodes.size() && iterationNodes[i] > 0; i++) {
+        std::format_to(std::back_inserter(out), "{}{:.3f}", i > 2 ? ", " : "", ebf(i));
     }
-    if (score < -mate_threshold) {
-        return score + ply;
+    out.append("]}");
+}
+
+void SearchParams::init() {
+    for (int32_t depth = 0; depth <= max_depth; depth++) {
+        for (int32_t moves = 0; moves < 256; moves++) {
+            if (depth == 0 || moves == 0) {
+                reductions[depth][moves] = 0;
+                continue;
+            }
+            double r = lmrBase / 100.0 + std::log(depth) * std::log(moves) / (lmrDivisor / 100.0);
+            reductions[depth][moves] = std::clamp<int32_t>(r, 0, max_depth);
+        }
     }
-    return score;
 }
 
-inline bool TranspositionTable::probe(uint64_t hash, TableEntry &entry, uint8_t ply) const {
-    entry = get(hash);
-    if (!bool(entry.depth) || entry.hash != hash) {
-        return false;
+bool SearchParams::setVariant(std::string_view name) {
+    for (uint8_t i = 0; i < search_variants.size(); i++) {
+        if (search_variants[i].name == name) {
+            variant = i;
+            return true;
+        }
     }
-    entry.score = score_from_tt(entry.score, ply);
-    return true;
+    return false;
 }
 
-inline void TranspositionTable::update(uint64_t hash, uint8_t gen, uint32_t depth, Move bestMove,
-                                       Score bestScore, NodeType flag, uint8_t ply) {
-    TableEntry &entry = get(hash);
-    bestScore = score_to_tt(bestScore, ply);
-    if (depth >= entry.depth || entry.age() != gen) {
-        entry.score = bestScore;
-        entry.best = bestMove;
-        entry.depth = depth;
-        entry.hash = hash;
-        entry.gen = uint8_t(flag) | gen;
+bool SearchParams::set(std::string_view name, int32_t value) {
+    if (name == "LmrBase") {
+        lmrBase = value;
+    } else if (name == "LmrDivisor") {
+        lmrDivisor = std::max(1, value);
+    } else {
+        return false;
     }
+    init();
+    return true;
 }
 
 void SearchContext::reset() {
     thinkingTime = 0;
+    nodeLimit = 0;
+    mateLimit = 0;
+    gen = 0;
     table = nullptr;
     resetSearch();
 }
 
 void SearchContext::resetSearch() {
-    stop = false;
     nodes = 0;
+    selDepth = 0;
+    lastReport = {};
+    stats = SearchStats{};
     gen = (gen + 1) & gen_mask;
     moves.clear();
+    killers = {};
     memset(&history[0], 0, sizeof(history));
-    // stack.clear();
+    counterMoves = {};
+    memset(&captureHistory[0], 0, sizeof(captureHistory));
+    memset(contHist.get(), 0, sizeof(ContinuationHistory));
+    for (auto &element : stack) {
+        element.staticEval = no_score;
+        element.inCheck = false;
+        element.move = Move{};
+        element.piece = 0;
+        element.excluded = Move{};
+        element.pvLength = 0;
+    }
 }
 
 void SearchContext::history_decay() {
@@ -102,7 +191,10 @@ void SearchContext::history_decay() {
     }
 }
 
-void SearchContext::startTimer() { timeStart = std::chrono::steady_clock::now(); }
+void SearchContext::startTimer() {
+    timeStart = std::chrono::steady_clock::now();
+    stop = false;
+}
 
 bool SearchContext::timeUp() const {
     if (thinkingTime <= 0) {
@@ -113,32 +205,97 @@ bool SearchContext::timeUp() const {
     return elapsed.count() > thinkingTime;
 }
 
-Score score_move(SearchContext &ctx, Game &game, Move move) {
-    Score score = 0;
+// winning and equal captures go before killers, losing ones after all quiet moves
+constexpr Score good_capture_score = 20000;
+constexpr Score bad_capture_score = -20000;
+constexpr Score counter_move_score = 14000;
+// keeps quiet moves below killers and counter moves
+constexpr int32_t max_quiet_score = 12000;
+constexpr int32_t pawn_threat_penalty = 4000;
+
+// continuation history of the move played `back` plies before the node at `ply`
+inline PieceToHistory *continuation(SearchContext &ctx, int32_t ply, int32_t back) {
+    if (ply - back < 0) {
+        return nullptr;
+    }
+    const StackElement &prev = ctx.stack[ply - back];
+    if (prev.move == Move{}) {
+        return nullptr;
+    }
+    return &(*ctx.contHist)[prev.piece][prev.move.to];
+}
+
+// piece type taken by a capture, en passant takes a pawn
+inline uint8_t captured_piece(Game &game, Move move) {
+    uint8_t captured = game.get_piece_at(move.to);
+    return captured == uint8_t(Piece::NONE) ? uint8_t(Piece::PAWN) : captured;
+}
+
+inline int16_t &capture_history(SearchContext &ctx, Game &game, Move move) {
+    return ctx.captureHistory[history_piece(game.board[move.from])][move.to]
+                             [captured_piece(game, move)];
+}
+
+// Captures are ordered by victim value and capture history. The exchange value only decides
+// whether a capture is searched before the quiet moves or after them.
+template <SearchFeatures features>
+Score score_capture(SearchContext &ctx, Game &game, Move move, bool winning) {
+    int32_t value = Evaluation::pieceValues[captured_piece(game, move)];
+    if constexpr (features.history) {
+        value += capture_history(ctx, game, move) / 16;
+    }
+    if (move.promote != Piece::NONE) {
+        value += Evaluation::pieceValues[uint8_t(move.promote)] -
+                 Evaluation::pieceValues[uint8_t(Piece::PAWN)];
+    }
+    return (winning ? good_capture_score : bad_capture_score) + value;
+}
+
+template <SearchFeatures features>
+Score score_move(SearchContext &ctx, Game &game, Move move, int32_t ply) {
+    if (move.is_capture()) {
+        count(ctx.stats.seeCalls);
+        return score_capture<features>(ctx, game, move, game.see_ge(move, 0));
+    }
     if (move.promote == Piece::QUEEN) {
-        score = 20000;
-    } else if (move.promote != Piece::NONE) {
-        score = 13000;
+        return good_capture_score + Evaluation::pieceValues[uint8_t(Piece::QUEEN)] -
+               Evaluation::pieceValues[uint8_t(Piece::PAWN)];
+    }
+    if (move.promote != Piece::NONE) {
+        return bad_capture_score;
     }
 
-    if (move.flags == MoveType::MOVE_CAPTURE) {
-        Score see = game.see(move.from, move.to, game.color);
-        if (see >= 0) {
-            return 16000 + see + score;
-        } else {
-            return 16000 - see + score;
+    const StackElement &prev = ctx.stack[ply - 1];
+    if constexpr (features.counterMoves) {
+        if (prev.move != Move{} && ctx.counterMoves[prev.piece][prev.move.to] == move) {
+            return counter_move_score;
         }
     }
-    if (score > 0) {
-        return score;
-    }
 
-    return ctx.history[game.color][move.from][move.to];
+    int32_t value = 0;
+    if constexpr (features.history) {
+        value += ctx.history[game.color][move.from][move.to];
+    }
+    // pieces stepping onto a square attacked by an enemy pawn are usually lost
+    if (game.get_piece_at(move.from) != uint8_t(Piece::PAWN) &&
+        (game.attack_info().pawnAttacks[!game.color] & position_to_bitboard(move.to))) {
+        value -= pawn_threat_penalty;
+    }
+    if constexpr (features.history) {
+        uint8_t piece = history_piece(game.board[move.from]);
+        for (int32_t back = 1; back <= 2; back++) {
+            if (PieceToHistory *cont = continuation(ctx, ply, back)) {
+                value += (*cont)[piece][move.to];
+            }
+        }
+    }
+    return std::clamp(value, -max_quiet_score, max_quiet_score);
 }
 
-void score_moves(SearchContext &ctx, Game &game, MoveList &moves) {
+template <SearchFeatures features>
+void score_moves(SearchContext &ctx, Game &game, MoveList &moves, int32_t ply) {
     for (auto &move : moves) {
-        move.score = score_move(ctx, game, move.move);
+        move.score = score_move<features>(ctx, game, move.move, ply);
     }
 }
 
@@ -154,20 +311,7 @@ void sort_moves(MoveList &moves) {
     }
 }
 
-uint32_t find_best(SearchContext &ctx, Game &game, MoveList &moves) {
-    uint32_t best = 0;
-    int32_t bestScore = -max_value;
-    for (uint32_t i = 0; i < moves.size(); i++) {
-        int32_t score = score_move(ctx, game, moves[i].move);
-        if (score > bestScore) {
-            bestScore = score;
-            best = i;
-        }
-    }
-    return best;
-}
-
-inline Move find_next(Game &game, MoveList &moves, uint8_t idx) {
+inline Move find_next(MoveList &moves, uint8_t idx) {
     int32_t best = idx;
     Score bestScore = -mate;
     for (uint32_t i = idx; i < moves.size(); i++) {
@@ -180,7 +324,7 @@ inline Move find_next(Game &game, MoveList &moves, uint8_t idx) {
     return moves[idx].move;
 }
 
-inline ScoreMove find_next_rm(Game &game, MoveList &moves) {
+inline ScoreMove find_next_rm(MoveList &moves) {
     int32_t best = 0;
     Score bestScore = -mate;
     for (uint32_t i = 0; i < moves.size(); i++) {
@@ -217,26 +361,79 @@ inline void set_move_score(MoveList &moves, Move move, Score value) {
     }
 }
 
-void update_history(SearchContext &ctx, uint8_t color, Position from, Position to, int32_t bonus) {
+template <typename T> inline void apply_bonus(T &entry, int32_t bonus) {
     int32_t clampedBonus = std::clamp(bonus, -max_history, max_history);
-    ctx.history[color][from][to] +=
-        clampedBonus - ctx.history[color][from][to] * std::abs(clampedBonus) / max_history;
+    entry += clampedBonus - entry * std::abs(clampedBonus) / max_history;
 }
 
+void update_history(SearchContext &ctx, uint8_t color, Position from, Position to, int32_t bonus) {
+    apply_bonus(ctx.history[color][from][to], bonus);
+}
+
+// updates the butterfly and continuation histories of a quiet move played at `ply`
+void update_quiet_history(SearchContext &ctx, Game &game, int32_t ply, Move move, int32_t bonus) {
+    update_history(ctx, game.color, move.from, move.to, bonus);
+    uint8_t piece = history_piece(game.board[move.from]);
+    for (int32_t back = 1; back <= 2; back++) {
+        if (PieceToHistory *cont = continuation(ctx, ply, back)) {
+            apply_bonus((*cont)[piece][move.to], bonus);
+        }
+    }
+}
+
+template <SearchFeatures features>
 bool inline is_killer(SearchContext &ctx, uint8_t ply, Move move) {
-    return move == ctx.killers[ply][0] || move == ctx.killers[ply][1];
+    if constexpr (features.killers) {
+        return move == ctx.killers[ply][0] || move == ctx.killers[ply][1];
+    }
+    return false;
+}
+
+void update_pv(SearchContext &ctx, int32_t ply, Move move) {
+    StackElement &ss = ctx.stack[ply];
+    const StackElement &child = ctx.stack[ply + 1];
+    ss.pv[0] = move;
+    for (uint8_t i = 0; i < child.pvLength; i++) {
+        ss.pv[i + 1] = child.pv[i];
+    }
+    ss.pvLength = child.pvLength + 1;
+}
+
+// A table cutoff in a pv node leaves no line behind, the rest of the pv is read from the table
+// instead. The walk follows the stored best moves from `move` for at most depth plies.
+void pv_from_table(SearchContext &ctx, Game &game, int32_t ply, Move move, int32_t depth) {
+    StackElement &ss = ctx.stack[ply];
+    ss.pvLength = 0;
+    while (ss.pvLength < depth && ply + ss.pvLength < max_ply - 1 && game.is_pseudo_legal(move)) {
+        game.make_move(move);
+        if (game.is_check(!game.color)) {
+            game.undo_move(move);
+            break;
+        }
+        ss.pv[ss.pvLength++] = move;
+        TableEntry entry;
+        if (game.is_draw() || !ctx.table->probe(game.hash, entry, ply + ss.pvLength)) {
+            break;
+        }
+        move = entry.best;
+    }
+    for (uint8_t i = ss.pvLength; i > 0; i--) {
+        game.undo_move(ss.pv[i - 1]);
+    }
 }
 
+template <SearchFeatures features>
 Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_t depth,
              int32_t ply, bool is_pv, bool allowNullMove) {
     if (ctx.stop) {
         return 0;
     }
     ctx.nodes++;
+    ctx.checkLimits();
+    ctx.selDepth = std::max<uint32_t>(ctx.selDepth, ply);
 
-    if ((ctx.nodes & 2047) == 0 && ctx.timeUp()) {
-        ctx.stop = true;
-    }
+    StackElement &ss = ctx.stack[ply];
+    ss.pvLength = 0;
 
     // check for draw
     if (game.is_draw()) {
@@ -248,30 +445,152 @@ Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_
     }
 
     if (depth <= 0) {
-        return quiescence(ctx, game, alpha, beta);
+        return quiescence<features>(ctx, game, alpha, beta, ply);
     }
 
     bool check = game.is_check(game.color);
+    if (ply >= max_ply - 1) {
+        return check ? 0 : signedColor[game.color] * Evaluation::tapered_eval(game);
+    }
+
+    ss.inCheck = check;
+    ctx.stack[ply + 1].excluded = Move{};
+    Move excluded = ss.excluded;
+
+    // tt entry
+    TableEntry entry;
+    bool validTE = false;
+    if (excluded == Move{}) {
+        validTE = ctx.table->probe(game.hash, entry, ply);
+        count(ctx.stats.ttProbes);
+    }
+    Move ttMove = validTE ? entry.best : Move{};
+    if (validTE) {
+        count(ctx.stats.ttHits);
+        if (entry.depth >= depth && !(is_mate(entry.score) && (entry.age() != ctx.gen))) {
+            NodeType type = entry.type();
+            if (type == NodeType::EXACT || (type == NodeType::LOWER_BOUND && entry.score >= beta) ||
+                (type == NodeType::UPPER_BOUND && entry.score <= alpha)) {
+                count(ctx.stats.ttCutoffs);
+                if (is_pv) {
+                    pv_from_table(ctx, game, ply, entry.best, entry.depth);
+                }
+                return entry.score;
+            }
+        }
+    }
+
+    // static evaluation, reused by all pruning decisions of this node
+    Score staticEval = no_score;
+    if (!check) {
+        count(ctx.stats.evalCalls);
+        staticEval = signedColor[game.color] * Evaluation::tapered_eval(game);
+    }
+    ss.staticEval = staticEval;
+    bool improving =
+        !check && ply >= 2 && ctx.stack[ply - 2].staticEval != no_score &&
+        staticEval > ctx.stack[ply - 2].staticEval;
 
     // reverse futility pruning
-    if (!is_pv && !check && depth <= 3 && !is_mate(beta)) {
-        Score eval = signedColor[game.color] * Evaluation::tapered_eval(game);
-        Score margin = 150 * depth;
-        if (eval >= beta + margin) {
-            return eval;
+    if constexpr (features.reverseFutility) {
+        if (!is_pv && !check && depth <= 3 && !is_mate(beta)) {
+            count(ctx.stats.rfpTries);
+            Score margin = 150 * (depth - improving);
+            if (staticEval >= beta + margin) {
+                count(ctx.stats.rfpCutoffs);
+                return staticEval;
+            }
+        }
+    }
+
+    // razoring
+    if constexpr (features.razoring) {
+        if (!is_pv && !check && !improving && depth <= 2 && !is_mate(alpha) &&
+            staticEval + 300 * depth < alpha) {
+            count(ctx.stats.razorTries);
+            Score score = quiescence<features>(ctx, game, alpha, alpha + 1, ply);
+            if (score <= alpha) {
+                count(ctx.stats.razorCutoffs);
+                return score;
+            }
         }
     }
 
     // null move
-    if (!is_pv && allowNullMove && depth >= 3 && !check && game.has_non_pawn_material(game.color)) {
-        constexpr int R = 2;
+    if constexpr (features.nullMove) {
+        if (!is_pv && allowNullMove && depth >= 3 && !check && excluded == Move{} &&
+            game.has_non_pawn_material(game.color)) {
+            constexpr int R = 2;
+
+            count(ctx.stats.nullMoveTries);
+            ss.move = Move{};
+            game.make_null_move();
+            Score score = -search<features>(ctx, game, -beta, -beta + 1, depth - 1 - R, ply + 1,
+                                            false, false);
+            game.undo_null_move();
+
+            if (score >= beta) {
+                count(ctx.stats.nullMoveCutoffs);
+                return score;
+            }
+        }
+    }
 
-        game.make_null_move();
-        Score score = -search(ctx, game, -beta, -beta + 1, depth - 1 - R, ply + 1, false, false);
-        game.undo_null_move();
+    // probcut
+    if constexpr (features.probcut) {
+        Score probcutBeta = beta + probcut_margin;
+        if (!is_pv && !check && depth >= probcut_depth && excluded == Move{} && !is_mate(beta) &&
+            !(validTE && entry.depth >= depth - probcut_reduction + 1 &&
+              entry.score < probcutBeta)) {
+            MoveList captures;
+            game.pseudo_legal_captures(captures);
+            score_moves<features>(ctx, game, captures, ply);
+            while (captures.size() > 0) {
+                Move move = find_next_rm(captures).move;
+                // only captures that win enough material on their own
+                count(ctx.stats.seeCalls);
+                if (!move.is_capture() || !game.see_ge(move, probcutBeta - staticEval)) {
+                    continue;
+                }
 
-        if (score >= beta) {
-            return score;
+                ss.piece = history_piece(game.board[move.from]);
+                game.make_move(move);
+                if (game.is_check(!game.color)) {
+                    game.undo_move(move);
+                    continue;
+                }
+                ss.move = move;
+                count(ctx.stats.probcutTries);
+
+                // verify with quiescence before spending the reduced search
+                Score score =
+                    -quiescence<features>(ctx, game, -probcutBeta, -probcutBeta + 1, ply + 1);
+                if (score >= probcutBeta) {
+                    score = -search<features>(ctx, game, -probcutBeta, -probcutBeta + 1,
+                                              depth - probcut_reduction, ply + 1, false, true);
+                }
+                game.undo_move(move);
+
+                if (ctx.stop) {
+                    return 0;
+                }
+                if (score >= probcutBeta) {
+                    count(ctx.stats.probcutCutoffs);
+                    ctx.table->update(game.hash, ctx.gen, depth - probcut_reduction + 1, move,
+                                      score, NodeType::LOWER_BOUND, ply);
+                    return score;
+                }
+            }
+        }
+    }
+
+    // internal iterative reduction, without a tt move the ordering of this node is poor. A
+    // shallower search is cheaper and leaves a move in the table for the next iteration.
+    if constexpr (features.iir) {
+        if (ttMove == Move{} && excluded == Move{} &&
+            depth >= (is_pv ? iir_pv_depth : iir_non_pv_depth)) {
+            count(ctx.stats.iirReductions);
+            depth--;
         }
     }
 
@@ -280,91 +599,124 @@ Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_
     uint8_t legalMoves = 0;
     Move bestMove{};
 
-    // tt entry
-    TableEntry entry;
-    bool validTE = ctx.table->probe(game.hash, entry, ply);
-    if (validTE) {
-        if (entry.depth >= depth && !(is_mate(entry.score) && (entry.age() != ctx.gen))) {
-            NodeType type = entry.type();
-            if (type == NodeType::EXACT) {
-                return entry.score;
-            } else if (type == NodeType::LOWER_BOUND && entry.score >= beta) {
-                return entry.score;
-            } else if (type == NodeType::UPPER_BOUND && entry.score <= alpha) {
-                return entry.score;
-            }
-        }
-
-        if (game.is_pseudo_legal(entry.best)) {
-            game.make_move(entry.best);
-            if (!game.is_check(!game.color)) {
-                bestScore = -search(ctx, game, -beta, -alpha, depth - 1, ply + 1, true, true);
-                if (bestScore >= beta) {
-                    game.undo_move(entry.best);
-                    ctx.table->update(game.hash, ctx.gen, depth, entry.best, bestScore,
+    if (ttMove != excluded && game.is_pseudo_legal(ttMove)) {
+        ss.piece = history_piece(game.board[ttMove.from]);
+        game.make_move(ttMove);
+        if (!game.is_check(!game.color)) {
+            ss.move = ttMove;
+            bestScore =
+                -search<features>(ctx, game, -beta, -alpha, depth - 1, ply + 1, is_pv, true);
+            if (bestScore >= beta) {
+                count(ctx.stats.betaCutoffs);
+                count(ctx.stats.firstMoveCutoffs);
+                game.undo_move(ttMove);
+                if (excluded == Move{}) {
+                    ctx.table->update(game.hash, ctx.gen, depth, ttMove, bestScore,
                                       NodeType::LOWER_BOUND, ply);
-                    return bestScore;
                 }
-                if (bestScore > alpha) {
-                    alpha = bestScore;
-                    flag = NodeType::EXACT;
+                return bestScore;
+            }
+            if (bestScore > alpha) {
+                alpha = bestScore;
+                flag = NodeType::EXACT;
+                if (is_pv) {
+                    update_pv(ctx, ply, ttMove);
                 }
-                bestMove = entry.best;
-                legalMoves++;
             }
-            game.undo_move(bestMove);
+            bestMove = ttMove;
+            legalMoves++;
         }
+        game.undo_move(ttMove);
     }
 
     MoveList moves;
+    // the legal moves searched so far apart from the tt move, only these earn a history penalty
+    StackList<Move, 256> searched;
 
     game.pseudo_legal_moves(moves);
-    score_moves(ctx, game, moves);
+    score_moves<features>(ctx, game, moves, ply);
 
     // killer moves
-    for (uint8_t i = 0; i < 2; i++) {
-        set_move_score(moves, ctx.killers[ply][i], mate / 2 - i);
+    if constexpr (features.killers) {
+        for (uint8_t i = 0; i < 2; i++) {
+            set_move_score(moves, ctx.killers[ply][i], mate / 2 - i);
+        }
     }
 
+    bool canPrune = !is_pv && !check;
+    Score futilityMargin = 100 + 100 * depth + 50 * improving;
+
     sort_moves(moves);
     for (uint8_t i = 0; i < moves.size(); i++) {
         Move move = moves[i].move;
-        if (move == entry.best) {
+        if (move == ttMove || move == excluded) {
             continue;
         }
 
+        bool quiet = !move.is_tactical() && !is_killer<features>(ctx, ply, move);
+        if (canPrune && quiet && legalMoves > 0 && !is_mate(alpha)) {
+            // late move pruning
+            if constexpr (features.lmp) {
+                if (depth <= lmp_depth && legalMoves >= lmp_counts[improving][depth]) {
+                    count(ctx.stats.lmpPrunes);
+                    continue;
+                }
+            }
+            // futility pruning
+            if constexpr (features.futility) {
+                if (depth <= 3 && staticEval + futilityMargin <= alpha) {
+                    count(ctx.stats.futilityPrunes);
+                    continue;
+                }
+            }
+        }
+
+        ss.piece = history_piece(game.board[move.from]);
         game.make_move(move);
         if (game.is_check(!game.color)) {
             game.undo_move(move);
             continue;
         }
+        ss.move = move;
 
         int8_t reduction = 0;
         Score score;
         if (legalMoves == 0) {
-            score = -search(ctx, game, -beta, -alpha, depth - 1, ply + 1, true, true);
+            score = -search<features>(ctx, game, -beta, -alpha, depth - 1, ply + 1, is_pv, true);
         } else {
-            bool canReduce = depth >= 3 && legalMoves >= 4 && !check;
-            if (move.is_tactical() || is_killer(ctx, ply, move)) {
-                canReduce = false;
+            bool canReduce = false;
+            if constexpr (features.lmr) {
+                canReduce = depth >= 3 && legalMoves >= 4 && !check && !move.is_tactical() &&
+                            !is_killer<features>(ctx, ply, move);
             }
             if (canReduce) {
-                reduction = 1.0 + std::log(depth) * std::log(legalMoves) / 3;
-                reduction += bool(ctx.history[!game.color][move.from][move.to] < 0);
+                count(ctx.stats.lmrTries);
+                int32_t history = 0;
+                if constexpr (features.history) {
+                    history = ctx.history[!game.color][move.from][move.to];
+                }
+                reduction = ctx.params.reduction(depth, legalMoves, is_pv, improving, history);
             }
-            score =
-                -search(ctx, game, -alpha - 1, -alpha, depth - 1 - reduction, ply + 1, false, true);
+            score = -search<features>(ctx, game, -alpha - 1, -alpha, depth - 1 - reduction,
+                                      ply + 1, false, true);
             if (score > alpha && reduction > 0) {
-                score = -search(ctx, game, -alpha - 1, -alpha, depth - 1, ply + 1, false, true);
+                count(ctx.stats.lmrResearches);
+                score = -search<features>(ctx, game, -alpha - 1, -alpha, depth - 1, ply + 1,
+                                          false, true);
             }
             if (score > alpha && score < beta) {
-                score = -search(ctx, game, -beta, -alpha, depth - 1, ply + 1, false, true);
+                count(ctx.stats.pvsResearches);
+                score =
+                    -search<features>(ctx, game, -beta, -alpha, depth - 1, ply + 1, is_pv, true);
             }
         }
 
         if (score > alpha) {
             alpha = score;
             flag = NodeType::EXACT;
+            if (is_pv) {
+                update_pv(ctx, ply, move);
+            }
         }
 
         if (score > bestScore) {
@@ -376,36 +728,61 @@ Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_
         legalMoves++;
 
         if (score >= beta) {
+            count(ctx.stats.betaCutoffs);
+            if (legalMoves == 1) {
+                count(ctx.stats.firstMoveCutoffs);
+            }
             if (!move.is_capture()) {
                 // update killer moves
-                if (legalMoves > 1) {
-                    ctx.killers[ply][1] = ctx.killers[ply][0];
-                    ctx.killers[ply][0] = move;
+                if constexpr (features.killers) {
+                    if (legalMoves > 1) {
+                        ctx.killers[ply][1] = ctx.killers[ply][0];
+                        ctx.killers[ply][0] = move;
+                    }
                 }
 
-                // update history heuristic
-                update_history(ctx, game.color, move.from, move.to, depth * depth);
-                // penalize other quiet moves
-                for (uint8_t j = 0; j < i; j++) {
-                    Move quietMove = moves[j].move;
-                    if (quietMove.is_capture()) {
-                        continue;
+                if constexpr (features.counterMoves) {
+                    const StackElement &prev = ctx.stack[ply - 1];
+                    if (prev.move != Move{}) {
+                        ctx.counterMoves[prev.piece][prev.move.to] = move;
                     }
-                    if (quietMove == entry.best) {
-                        continue;
+                }
+
+                if constexpr (features.history) {
+                    // update history heuristic
+                    update_quiet_history(ctx, game, ply, move, depth * depth);
+                    // penalize the quiet moves searched before
+                    for (Move quietMove : searched) {
+                        if (quietMove.is_capture()) {
+                            continue;
+                        }
+                        if (is_killer<features>(ctx, ply, quietMove)) {
+                            continue;
+                        }
+                        update_quiet_history(ctx, game, ply, quietMove, -depth * depth);
                     }
-                    if (is_killer(ctx, ply, quietMove)) {
-                        continue;
+                }
+            } else if constexpr (features.history) {
+                apply_bonus(capture_history(ctx, game, move), depth * depth);
+            }
+            // penalize captures that were searched before and failed
+            if constexpr (features.history) {
+                for (Move capture : searched) {
+                    if (capture.is_capture()) {
+                        apply_bonus(capture_history(ctx, game, capture), -depth * depth);
                     }
-                    update_history(ctx, game.color, quietMove.from, quietMove.to, -depth * depth);
                 }
             }
             flag = NodeType::LOWER_BOUND;
             break;
         }
+        searched.push_back(move);
     }
 
     if (legalMoves == 0) {
+        if (excluded != Move{}) {
+            return alpha;
+        }
         if (check) {
             bestScore = -mate + ply;
         } else {
@@ -418,71 +795,141 @@ Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_
         return 0;
     }
 
-    ctx.table->update(game.hash, ctx.gen, depth, bestMove, bestScore, flag, ply);
+    if (excluded == Move{}) {
+        ctx.table->update(game.hash, ctx.gen, depth, bestMove, bestScore, flag, ply);
+    }
     return bestScore;
 }
 
-Score quiescence(SearchContext &ctx, Game &game, Score alpha, Score beta) {
-    ctx.nodes++;
+constexpr Score delta_margin = 200;
 
+template <SearchFeatures features>
+Score quiescence(SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t ply) {
     if (ctx.stop) {
         return 0;
     }
-
-    if ((ctx.nodes & 2047) == 0 && ctx.timeUp()) {
-        ctx.stop = true;
-    }
+    ctx.nodes++;
+    count(ctx.stats.qnodes);
+    ctx.checkLimits();
+    ctx.selDepth = std::max<uint32_t>(ctx.selDepth, ply);
 
     if (game.is_insufficient_material()) {
         return 0;
     }
 
-    Score static_eval = signedColor[game.color] * Evaluation::tapered_eval(game);
-    Score best_value = static_eval;
-    if (best_value > beta) {
-        return best_value;
+    bool check = game.is_check(game.color);
+    if (ply >= max_ply - 1) {
+        return check ? 0 : signedColor[game.color] * Evaluation::tapered_eval(game);
     }
-    if (best_value > alpha) {
-        alpha = best_value;
+
+    TableEntry entry;
+    bool validTE = ctx.table->probe(game.hash, entry, ply);
+    count(ctx.stats.ttProbes);
+    Move ttMove = validTE ? entry.best : Move{};
+    if (validTE) {
+        count(ctx.stats.ttHits);
+        NodeType type = entry.type();
+        if (!(is_mate(entry.score) && (entry.age() != ctx.gen)) &&
+            (type == NodeType::EXACT || (type == NodeType::LOWER_BOUND && entry.score >= beta) ||
+             (type == NodeType::UPPER_BOUND && entry.score <= alpha))) {
+            count(ctx.stats.ttCutoffs);
+            return entry.score;
+        }
     }
 
+    Score static_eval = no_score;
+    Score best_value = -mate + ply;
+    if (!check) {
+        count(ctx.stats.evalCalls);
+        static_eval = signedColor[game.color] * Evaluation::tapered_eval(game);
+        best_value = static_eval;
+        if (best_value >= beta) {
+            return best_value;
+        }
+        if (best_value > alpha) {
+            alpha = best_value;
+        }
+    }
+    Score origAlpha = alpha;
+    Move bestMove{};
+
     MoveList moves;
-    game.pseudo_legal_captures(moves);
-    score_moves(ctx, game, moves);
+    if (check) {
+        // all evasions have to be tried, otherwise mates are missed
+        game.pseudo_legal_moves(moves);
+    } else {
+        game.pseudo_legal_captures(moves);
+    }
+    score_moves<features>(ctx, game, moves, ply);
+    set_move_score(moves, ttMove, max_value);
 
     while (moves.size() > 0) {
-        Move move = find_next_rm(game, moves).move;
-        if (game.see(move.from, move.to, game.color) < 0) {
-            continue;
+        ScoreMove next = find_next_rm(moves);
+        Move move = next.move;
+        if (!check) {
+            // losing captures are ordered last, every following move is losing as well
+            if (next.score < 0) {
+                break;
+            }
+            // delta pruning
+            if constexpr (features.deltaPruning) {
+                Score captured = Evaluation::pieceValues[captured_piece(game, move)];
+                if (move.promote == Piece::NONE && static_eval + captured + delta_margin <= alpha) {
+                    continue;
+                }
+            }
         }
+        ctx.stack[ply].piece = history_piece(game.board[move.from]);
         game.make_move(move);
         if (game.is_check(!game.color)) {
             game.undo_move(move);
             continue;
         }
-        Score score = -quiescence(ctx, game, -beta, -alpha);
+        ctx.stack[ply].move = move;
+        Score score = -quiescence<features>(ctx, game, -beta, -alpha, ply + 1);
         game.undo_move(move);
-        if (score >= beta) {
-            return score;
-        }
         if (score > best_value) {
             best_value = score;
+            bestMove = move;
+        }
+        if (score >= beta) {
+            break;
         }
         if (score > alpha) {
             alpha = score;
         }
     }
+
+    if (ctx.stop) {
+        return 0;
+    }
+
+    NodeType flag = best_value >= beta      ? NodeType::LOWER_BOUND
+                    : best_value > origAlpha ? NodeType::EXACT
+                                             : NodeType::UPPER_BOUND;
+    ctx.table->update(game.hash, ctx.gen, 0, bestMove, best_value, flag, ply);
     return best_value;
 }
 
+template <SearchFeatures features>
 Score search_root(Search::SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t depth) {
+    if (ctx.stop) {
+        return 0;
+    }
     ctx.nodes++;
+    ctx.checkLimits();
     int32_t ply = 1;
     uint64_t entryIdx = game.hash & (ctx.table->size() - 1);
     Move bestMove;
 
+    StackElement &ss = ctx.stack[ply];
+    ss.pvLength = 0;
+    ss.inCheck = game.is_check(game.color);
+    ss.staticEval =
+        ss.inCheck ? no_score : signedColor[game.color] * Evaluation::tapered_eval(game);
+
     TableEntry &entry = ctx.table->table[entryIdx];
-    if (bool(entry.depth) && entry.hash == game.hash) {
+    if (!entry.empty() && entry.hash == game.hash) {
         push_move_to_front(ctx.moves, entry.best);
     }
 
@@ -490,17 +937,25 @@ Score search_root(Search::SearchContext &ctx, Game &game, Score alpha, Score bet
     NodeType flag = NodeType::UPPER_BOUND;
     Score origAlpha = alpha;
 
+    bool announce = ctx.report && !ctx.onIteration &&
+                    std::chrono::steady_clock::now() - ctx.timeStart >= currmove_delay;
     for (uint8_t i = 0; i < ctx.moves.size(); i++) {
         ScoreMove &move = ctx.moves[i];
+        if (announce && !IO::json) {
+            IO::sendCurrMove(depth, move.move, i + 1);
+        }
+        ss.piece = history_piece(game.board[move.move.from]);
         game.make_move(move.move);
+        ss.move = move.move;
 
         Score score;
         if (i == 0) {
-            score = -search(ctx, game, -beta, -alpha, depth - 1, ply + 1, true, true);
+            score = -search<features>(ctx, game, -beta, -alpha, depth - 1, ply + 1, true, true);
         } else {
-            score = -search(ctx, game, -alpha - 1, -alpha, depth - 1, ply + 1, false, true);
+            score =
+                -search<features>(ctx, game, -alpha - 1, -alpha, depth - 1, ply + 1, false, true);
             if (score > alpha && score < beta) {
-                score = -search(ctx, game, -beta, -alpha, depth - 1, ply + 1, false, true);
+                score = -search<features>(ctx, game, -beta, -alpha, depth - 1, ply + 1, true, true);
             }
         }
 
@@ -517,6 +972,7 @@ Score search_root(Search::SearchContext &ctx, Game &game, Score alpha, Score bet
             if (score > alpha) {
                 alpha = score;
                 flag = NodeType::EXACT;
+                update_pv(ctx, ply, move.move);
             }
         }
 
@@ -528,56 +984,73 @@ Score search_root(Search::SearchContext &ctx, Game &game, Score alpha, Score bet
         return 0;
     }
 
-    update_history(ctx, game.color, bestMove.from, bestMove.to, depth * depth);
+    if constexpr (features.history) {
+        update_history(ctx, game.color, bestMove.from, bestMove.to, depth * depth);
+    }
     ctx.table->update(game.hash, ctx.gen, depth, bestMove, bestScore, flag, ply);
 
     return bestScore;
 }
-void calculate_pv_moves(SearchContext &ctx, Game &game, std::vector<Move> &moves, int8_t depth) {
-    auto move = moves.back();
-    game.make_move(move);
 
-    if (game.is_draw()) {
-        game.undo_move(move);
-        return;
-    }
+using RootSearch = Score (*)(SearchContext &, Game &, Score, Score, int32_t);
 
-    Search::TableEntry &entry = ctx.table->get(game.hash);
-    if (entry.hash != game.hash) {
-        game.undo_move(move);
-        return;
-    }
+// one instantiation of the search per variant, chosen once per search instead of at every node
+constexpr auto root_searches = []<size_t... I>(std::index_sequence<I...>) {
+    return std::array<RootSearch, sizeof...(I)>{&search_root<search_variants[I].features>...};
+}(std::make_index_sequence<search_variants.size()>());
 
-    if (!game.is_pseudo_legal(entry.best)) {
+void report_iteration(SearchContext &ctx, const SearchResult &result) {
+    if (ctx.onIteration) {
+        ctx.onIteration(result);
         return;
     }
-
-    moves.push_back(entry.best);
-    if (depth > 0) {
-        calculate_pv_moves(ctx, game, moves, depth - 1);
+    uint32_t hashfull = ctx.table->hashFull();
+    IO::sendSearchInfo(result, hashfull);
+    if (IO::json) {
+        IO::sendStatsJson(result, hashfull, ctx.stats);
+    } else if constexpr (collect_stats) {
+        IO::sendStats(ctx.stats, result.depth, ctx.nodes);
     }
-
-    game.undo_move(move);
+    IO::flush();
 }
 
 SearchResult iterative_deepening(SearchContext &ctx, Game &game, uint32_t depth) {
     ctx.resetSearch();
-    SearchResult lastResult;
-    auto start = ctx.timeStart;
+    SearchResult lastResult{};
+    // the last completed iteration has not been reported yet
+    bool unreported = false;
 
     game.legal_moves(ctx.moves);
+    // A mated or stalemated side has nothing to search, every root search would fail low and the
+    // aspiration window could never settle.
+    if (ctx.moves.empty()) {
+        lastResult.score = game.is_check(game.color) ? -mate : 0;
+        lastResult.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - ctx.timeStart)
+                                 .count();
+        if (ctx.report) {
+            report_iteration(ctx, lastResult);
+        }
+        return lastResult;
+    }
+    // a search stopped before its first iteration completes still answers with a legal move
+    lastResult.bestMove = ctx.moves[0].move;
+    // a long game may have filled the reserved history, the search must not grow it
+    game.history.reserve(game.history.size() + max_ply);
     int32_t alpha = -mate;
     int32_t beta = mate;
     int32_t score = 0;
+    RootSearch root = root_searches[std::min<size_t>(ctx.params.variant, root_searches.size() - 1)];
 
     for (uint32_t i = 1; i <= depth; i++) {
+        uint64_t iterationStart = ctx.nodes;
         int32_t delta = 30;
         alpha = i > 1 ? score - delta : -mate;
         beta = i > 1 ? score + delta : mate;
 
         // aspiration windows with gradual widening
         while (!ctx.stop) {
-            score = search_root(ctx, game, alpha, beta, i);
+            score = root(ctx, game, alpha, beta, i);
             if (score <= alpha) {
                 alpha = std::max(-mate, alpha - delta);
             } else if (score >= beta) {
@@ -595,29 +1068,56 @@ SearchResult iterative_deepening(SearchContext &ctx, Game &game, uint32_t depth)
         sort_moves(ctx.moves);
         ScoreMove bestMove = ctx.moves[0];
 
-        auto end = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-        std::vector<Move> pvs{ctx.moves[0].move};
-        calculate_pv_moves(ctx, game, pvs, i);
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - ctx.timeStart).count();
         SearchResult result{
             .score = bestMove.score,
             .bestMove = bestMove.move,
             .nodes = ctx.nodes,
-            .pv = pvs,
+            .pv = {bestMove.move},
+            .pvLength = 1,
             .depth = i,
+            .selDepth = ctx.selDepth - 1,
             .elapsed = elapsed,
         };
-        IO::sendSearchInfo(result, ctx.table->hashFull());
-
-        start = end;
+        // the pv collected by the root belongs to the last move that raised alpha
+        const StackElement &root = ctx.stack[1];
+        if (root.pvLength > 0 && root.pv[0] == bestMove.move) {
+            std::copy_n(root.pv.begin(), root.pvLength, result.pv.begin());
+            result.pvLength = root.pvLength;
+        }
+        if constexpr (collect_stats) {
+            ctx.stats.iterationNodes[i] = ctx.nodes - iterationStart;
+        }
         lastResult = result;
+        unreported = true;
+        // only the uci output is throttled, a callback sees every iteration
+        if (ctx.report && (ctx.onIteration || now - ctx.lastReport >= report_interval)) {
+            report_iteration(ctx, result);
+            ctx.lastReport = now;
+            unreported = false;
+        }
 
         if (is_mate(result.score)) {
             break;
         }
 
+        if (ctx.mateLimit > 0 && i >= 2 * ctx.mateLimit + 2) {
+            break;
+        }
+
         ctx.history_decay();
     }
+    if (ctx.report && unreported) {
+        report_iteration(ctx, lastResult);
+    }
     return lastResult;
 }
+
+template void score_moves(SearchContext &ctx, Game &game, MoveList &moves, int32_t ply);
+template Score search(SearchContext &ctx, Game &game, int32_t alpha, int32_t beta, int32_t depth,
+                      int32_t ply, bool is_pv, bool allowNullMove);
+template Score quiescence(SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t ply);
+template Score search_root(SearchContext &ctx, Game &game, Score alpha, Score beta, int32_t depth);
 } // namespace Mondfisch::Search
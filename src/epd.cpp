@@ -0,0 +1,110 @@
+#include "epd.h"
+#include "batch.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace Mondfisch::Epd {
+
+bool Entry::solvedBy(Move move) const {
+    auto contains = [move](const std::vector<Move> &moves) {
+        return std::find(moves.begin(), moves.end(), move) != moves.end();
+    };
+    if (!bestMoves.empty() && !contains(bestMoves)) {
+        return false;
+    }
+    return !contains(avoidMoves);
+}
+
+bool parse(std::string_view line, Game &game, Entry &entry) {
+    entry = Entry{};
+    entry.fen = Batch::epd_to_fen(line);
+    game.loadFen(entry.fen);
+
+    // the operations follow the four position fields
+    size_t pos = 0;
+    for (int field = 0; field < 4 && pos != std::string_view::npos; field++) {
+        pos = line.find_first_not_of(' ', pos);
+        pos = pos == std::string_view::npos ? pos : line.find(' ', pos);
+    }
+    std::string_view operations = pos == std::string_view::npos ? "" : line.substr(pos);
+
+    while (!operations.empty()) {
+        size_t end = std::min(operations.find(';'), operations.size());
+        std::stringstream ss{std::string(operations.substr(0, end))};
+        operations.remove_prefix(std::min(end + 1, operations.size()));
+
+        std::string opcode;
+        std::string operand;
+        ss >> opcode;
+        if (opcode == "bm" || opcode == "am") {
+            std::vector<Move> &moves = opcode == "bm" ? entry.bestMoves : entry.avoidMoves;
+            while (ss >> operand) {
+                Move move = game.parseSan(operand);
+                if (move == Move{}) {
+                    return false;
+                }
+                moves.push_back(move);
+            }
+        } else if (opcode == "id") {
+            std::getline(ss >> std::ws, operand);
+            entry.id = operand;
+            std::erase(entry.id, '"');
+        }
+    }
+    return !entry.bestMoves.empty() || !entry.avoidMoves.empty();
+}
+
+Summary run(std::span<const Entry> entries, const Options &options, std::vector<Result> &results) {
+    results.assign(entries.size(), Result{});
+    uint32_t depth = options.depth > 0 ? std::min<uint32_t>(options.depth, Search::max_depth)
+                                       : Search::max_depth;
+
+    auto start = std::chrono::steady_clock::now();
+    Batch::parallel_for(
+        entries.size(), options.threads, [&]() { return Batch::Worker(options.hash); },
+        [&](Batch::Worker &worker, size_t i) {
+            const Entry &entry = entries[i];
+            Result &result = results[i];
+            worker.load(entry.fen);
+            worker.ctx.thinkingTime = options.time;
+            worker.ctx.nodeLimit = options.nodes;
+            worker.ctx.report = true;
+            worker.ctx.onIteration = [&](const Search::SearchResult &iteration) {
+                if (!entry.solvedBy(iteration.bestMove)) {
+                    result.timeToSolution = -1;
+                } else if (result.timeToSolution < 0) {
+                    result.timeToSolution = iteration.elapsed;
+                    result.nodesToSolution = iteration.nodes;
+                }
+            };
+            worker.ctx.startTimer();
+            auto searchResult = Search::iterative_deepening(worker.ctx, worker.game, depth);
+            worker.ctx.onIteration = nullptr;
+
+            result.bestMove = searchResult.bestMove;
+            result.depth = searchResult.depth;
+            result.solved = searchResult.depth > 0 && entry.solvedBy(searchResult.bestMove);
+            if (!result.solved) {
+                result.timeToSolution = -1;
+                result.nodesToSolution = 0;
+            }
+            result.nodes = worker.ctx.nodes;
+            result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now() - worker.ctx.timeStart)
+                                 .count();
+        });
+    auto end = std::chrono::steady_clock::now();
+
+    Summary summary{};
+    for (const Result &result : results) {
+        summary.solved += result.solved;
+        summary.nodes += result.nodes;
+        summary.searchTime += result.elapsed;
+    }
+    summary.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    summary.nps = summary.nodes * 1000 / std::max<int64_t>(summary.searchTime, 1);
+    return summary;
+}
+
+} // namespace Mondfisch::Epd
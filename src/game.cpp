@@ -1,5 +1,6 @@
 #include "game.h"
 #include "evaluation.h"
+#include <algorithm>
 #include <array>
 #include <bit>
 #include <cassert>
@@ -84,12 +85,24 @@ uint8_t char2Piece(char c) {
     }
     return (uint8_t)Piece::NONE;
 }
-std::string Move::toSimpleNotation() const {
-    std::string res = std::format("{}{}", pos2str(from), pos2str(to));
+char *Move::writeSimpleNotation(char *out) const {
+    // the null move of the uci protocol, e.g. the bestmove of a position without legal moves
+    if (from == to) {
+        return std::copy_n("0000", 4, out);
+    }
+    *out++ = files[file_from_pos(from)];
+    *out++ = '1' + rank_from_pos(from);
+    *out++ = files[file_from_pos(to)];
+    *out++ = '1' + rank_from_pos(to);
     if (promote != Piece::NONE) {
-        res.push_back(pieceChars[(uint8_t)promote]);
+        *out++ = pieceChars[(uint8_t)promote];
     }
-    return res;
+    return out;
+}
+
+std::string Move::toSimpleNotation() const {
+    std::array<char, max_notation_length> buffer;
+    return std::string(buffer.data(), writeSimpleNotation(buffer.data()));
 }
 
 std::string Move::toAlgebraicNotation(uint8_t coloredPiece) const {
@@ -162,9 +175,44 @@ void Game::reset() {
     }
     undoStack.clear();
     history.clear();
+    history.reserve(history_capacity);
+    attackInfo.valid = false;
     hash = get_hash();
 }
 
+void Game::compute_attack_info() {
+    AttackInfo &info = attackInfo;
+    info.hash = hash;
+    info.valid = true;
+    for (uint8_t side = 0; side < 2; side++) {
+        BitBoard pawns = 0;
+        for (Position pos : BitRange{bitboard[side][uint8_t(Piece::PAWN)]}) {
+            pawns |= pawnAttacks[side][pos];
+        }
+        info.pawnAttacks[side] = pawns;
+        Position king = bitboard_to_position(bitboard[side][uint8_t(Piece::KING)]);
+        info.attacks[side] = pawns | kingMoves[king];
+        info.sliderAttacks[side] = 0;
+        for (uint8_t piece = uint8_t(Piece::QUEEN); piece < uint8_t(Piece::PAWN); piece++) {
+            for (Position pos : BitRange{bitboard[side][piece]}) {
+                BitBoard attacks = 0;
+                if (piece == uint8_t(Piece::KNIGHT)) {
+                    attacks = knightMoves[pos];
+                } else {
+                    if (piece != uint8_t(Piece::BISHOP)) {
+                        attacks |= rook_attacks(pos, occupancyBoth);
+                    }
+                    if (piece != uint8_t(Piece::ROOK)) {
+                        attacks |= bishop_attacks(pos, occupancyBoth);
+                    }
+                    info.sliderAttacks[side] |= attacks;
+                }
+                info.attacks[side] |= attacks;
+            }
+        }
+    }
+}
+
 void Game::calculateOccupancy() {
     occupancy[WHITE] = 0;
     occupancy[BLACK] = 0;
@@ -588,6 +636,88 @@ int32_t Game::see(Position from, Position target, uint8_t side) {
     return value[0];
 }
 
+bool Game::see_ge(Move move, int32_t threshold) {
+    if (move.flags == MoveType::MOVE_CASTLE) {
+        return threshold <= 0;
+    }
+
+    Position target = move.to;
+    BitBoard occ = occupancyBoth ^ position_to_bitboard(move.from);
+    int32_t swap = -threshold;
+    if (move.flags == MoveType::MOVE_EP) {
+        swap += Evaluation::pieceValues[uint8_t(Piece::PAWN)];
+        occ ^= position_to_bitboard(color == WHITE ? backward(target, 1) : forward(target, 1));
+    } else if (board[target] != uint8_t(Piece::NONE)) {
+        swap += Evaluation::pieceValues[get_piece_at(target)];
+    }
+    int32_t nextVictim = Evaluation::pieceValues[get_piece_at(move.from)];
+    if (move.promote != Piece::NONE) {
+        swap += Evaluation::pieceValues[uint8_t(move.promote)] -
+                Evaluation::pieceValues[uint8_t(Piece::PAWN)];
+        nextVictim = Evaluation::pieceValues[uint8_t(move.promote)];
+    }
+    // even winning the moved piece for free does not reach the threshold
+    if (swap < 0) {
+        return false;
+    }
+    // losing the moved piece still keeps the threshold
+    swap = nextVictim - swap;
+    if (swap <= 0) {
+        return true;
+    }
+    // nothing can recapture: the target is not attacked and leaving `from` uncovers no slider
+    const AttackInfo &info = attack_info();
+    if (move.flags != MoveType::MOVE_EP &&
+        !((info.attacks[!color] & position_to_bitboard(target)) ||
+          (info.sliderAttacks[!color] & position_to_bitboard(move.from)))) {
+        return true;
+    }
+
+    BitBoard bishops = bitboard[0][uint8_t(Piece::BISHOP)] | bitboard[1][uint8_t(Piece::BISHOP)] |
+                       bitboard[0][uint8_t(Piece::QUEEN)] | bitboard[1][uint8_t(Piece::QUEEN)];
+    BitBoard rooks = bitboard[0][uint8_t(Piece::ROOK)] | bitboard[1][uint8_t(Piece::ROOK)] |
+                     bitboard[0][uint8_t(Piece::QUEEN)] | bitboard[1][uint8_t(Piece::QUEEN)];
+    BitBoard attackers = (attacks_to(target) | get_xray_attackers(target, 0, occ)) & occ;
+
+    // res is true while the side that made the last capture keeps the threshold
+    uint8_t side = color;
+    bool res = true;
+    while (true) {
+        side = !side;
+        attackers &= occ;
+        BitBoard sideAttackers = attackers & occupancy[side];
+        if (!sideAttackers) {
+            break;
+        }
+
+        uint8_t piece = uint8_t(Piece::PAWN);
+        while (!(sideAttackers & bitboard[side][piece])) {
+            piece--;
+        }
+        res = !res;
+
+        if (piece == uint8_t(Piece::KING)) {
+            // the king may only recapture if the other side has nothing left
+            return (attackers & occupancy[!side]) ? !res : res;
+        }
+
+        swap = Evaluation::pieceValues[piece] - swap;
+        if (swap < res) {
+            break;
+        }
+
+        occ ^= position_to_bitboard(bitboard_to_position(sideAttackers & bitboard[side][piece]));
+        if (piece == uint8_t(Piece::PAWN) || piece == uint8_t(Piece::BISHOP) ||
+            piece == uint8_t(Piece::QUEEN)) {
+            attackers |= bishop_attacks(target, occ) & bishops;
+        }
+        if (piece == uint8_t(Piece::ROOK) || piece == uint8_t(Piece::QUEEN)) {
+            attackers |= rook_attacks(target, occ) & rooks;
+        }
+    }
+    return res;
+}
+
 bool Game::is_sqaure_attacked(Position pos, uint8_t enemy) {
     BitBoard enemyPawns = bitboard[enemy][(uint8_t)Piece::PAWN];
     BitBoard attacks;
@@ -620,7 +750,8 @@ bool Game::is_sqaure_attacked(Position pos, uint8_t enemy) {
 bool Game::is_draw() { return halfmove >= 100 || is_repetition_draw(); }
 
 bool Game::is_repetition_draw() {
-    for (uint16_t i = 2; i < halfmove; i += 2) {
+    size_t plies = std::min<size_t>(halfmove, history.size());
+    for (size_t i = 2; i < plies; i += 2) {
         if (history[history.size() - 1 - i] == hash) {
             return true;
         }
@@ -652,13 +783,11 @@ bool Game::is_insufficient_material() {
     return false;
 }
 
+// Legality is tested after every make_move, most of these positions are never evaluated. A
+// single square test is much cheaper than building their attack maps.
 bool Game::is_check(uint8_t color) {
-    BitBoard board = bitboard[color][uint8_t(Piece::KING)];
-    Position pos = bitboard_to_position(board);
-    if (is_sqaure_attacked(pos, !color)) {
-        return true;
-    }
-    return false;
+    BitBoard king = bitboard[color][uint8_t(Piece::KING)];
+    return king != 0 && is_sqaure_attacked(bitboard_to_position(king), !color);
 }
 
 bool Game::has_non_pawn_material(uint8_t color) {
@@ -849,12 +978,135 @@ uint32_t Game::perft(uint32_t n) {
     return counter;
 }
 
-void Game::playMove(std::string &move) {
-    Position from = str2pos(move.substr(0, 2));
-    Position to = str2pos(move.substr(2, 4));
+Move Game::parseSan(std::string_view san) {
+    while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos) {
+        san.remove_suffix(1);
+    }
+    MoveList moves;
+    legal_moves(moves);
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool queenSide = san.size() == 5;
+        for (auto move : moves) {
+            if (move.move.flags == MoveType::MOVE_CASTLE &&
+                (file_from_pos(move.move.to) < 4) == queenSide) {
+                return move.move;
+            }
+        }
+        return Move{};
+    }
+
+    Piece promote = Piece::NONE;
+    size_t equals = san.find('=');
+    if (equals != std::string_view::npos && equals + 1 < san.size()) {
+        promote = piece_from_piece(char2Piece(std::toupper(san[equals + 1])));
+        san = san.substr(0, equals);
+    } else if (san.size() > 2 && std::isupper(san.back())) {
+        promote = piece_from_piece(char2Piece(san.back()));
+        san.remove_suffix(1);
+    }
+    Piece piece = Piece::PAWN;
+    if (!san.empty() && std::isupper(san.front())) {
+        piece = piece_from_piece(char2Piece(san.front()));
+        san.remove_prefix(1);
+    }
+    if (san.size() < 2) {
+        return Move{};
+    }
+    Position to = str2pos(std::string(san.substr(san.size() - 2)));
+    san.remove_suffix(2);
+
+    // disambiguation by the file and or rank of the moving piece, captures are marked with x
+    int8_t file = -1;
+    int8_t rank = -1;
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') {
+            file = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            rank = c - '1';
+        }
+    }
+
+    Move found{};
+    uint32_t matches = 0;
+    for (auto move : moves) {
+        Move m = move.move;
+        if (m.to != to || m.promote != promote || piece_from_piece(board[m.from]) != piece) {
+            continue;
+        }
+        if ((file >= 0 && file_from_pos(m.from) != file) ||
+            (rank >= 0 && rank_from_pos(m.from) != rank)) {
+            continue;
+        }
+        found = m;
+        matches++;
+    }
+    return matches == 1 ? found : Move{};
+}
+
+std::string Game::toSan(Move move) {
+    constexpr std::string_view letters = "KQRBNP";
+    std::string san;
+    Piece piece = piece_from_piece(board[move.from]);
+    MoveList moves;
+    legal_moves(moves);
+
+    if (move.flags == MoveType::MOVE_CASTLE) {
+        san = file_from_pos(move.to) < 4 ? "O-O-O" : "O-O";
+    } else {
+        bool capture = board[move.to] != uint8_t(Piece::NONE) || move.flags == MoveType::MOVE_EP;
+        if (piece == Piece::PAWN) {
+            if (capture) {
+                san.push_back(files[file_from_pos(move.from)]);
+            }
+        } else {
+            san.push_back(letters[uint8_t(piece)]);
+            // other pieces of the same type that reach the target
+            bool ambiguous = false;
+            bool sameFile = false;
+            bool sameRank = false;
+            for (auto other : moves) {
+                Move m = other.move;
+                if (m.to != move.to || m.from == move.from || board[m.from] != board[move.from]) {
+                    continue;
+                }
+                ambiguous = true;
+                sameFile |= file_from_pos(m.from) == file_from_pos(move.from);
+                sameRank |= rank_from_pos(m.from) == rank_from_pos(move.from);
+            }
+            if (ambiguous && (!sameFile || sameRank)) {
+                san.push_back(files[file_from_pos(move.from)]);
+            }
+            if (ambiguous && sameFile) {
+                san.push_back('1' + rank_from_pos(move.from));
+            }
+        }
+        if (capture) {
+            san.push_back('x');
+        }
+        san.append(pos2str(move.to));
+        if (move.promote != Piece::NONE) {
+            san.push_back('=');
+            san.push_back(letters[uint8_t(move.promote)]);
+        }
+    }
+
+    make_move(move);
+    if (is_check(color)) {
+        MoveList replies;
+        legal_moves(replies);
+        san.push_back(replies.empty() ? '#' : '+');
+    }
+    undo_move(move);
+    return san;
+}
+
+void Game::playMove(std::string_view move) {
+    Position from = coords_to_pos(file_from_char(move[0]), move[1] - '1');
+    Position to = coords_to_pos(file_from_char(move[2]), move[3] - '1');
     Piece promote = Piece::NONE;
     if (move.size() >= 5) {
-        promote = piece_from_piece(char2Piece(move.at(4)));
+        promote = piece_from_piece(char2Piece(move[4]));
     }
     MoveType flags = MoveType::NONE;
     if (board[to] != (uint8_t)Piece::NONE) {
@@ -884,6 +1136,7 @@ void Game::playMove(std::string &move) {
         .promote = promote,
     };
     make_move(m);
+    undoStack.pop_back();
 }
 
 uint64_t Game::get_hash() {
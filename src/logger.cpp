@@ -0,0 +1,93 @@
+#include "logger.h"
+#include <ctime>
+
+namespace Mondfisch {
+
+LogLevel log_level_from_string(std::string_view s) {
+    for (LogLevel level : {LogLevel::DEBUG, LogLevel::INFO, LogLevel::WARN, LogLevel::ERROR}) {
+        if (s == toString(level)) {
+            return level;
+        }
+    }
+    return LogLevel::NONE;
+}
+
+Logger::Logger() : records(std::make_unique<std::array<LogRecord, log_capacity>>()) {
+    for (uint64_t i = 0; i < log_capacity; i++) {
+        (*records)[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    line.reserve(log_message_size + 64);
+}
+
+bool Logger::open(const std::string &name) {
+    if (isOpen() && name == filename) {
+        return true;
+    }
+    close();
+    file = name.empty() ? stderr : std::fopen(name.c_str(), "a");
+    if (file == nullptr) {
+        return false;
+    }
+    filename = name;
+    // timestamps are relative to the start, the header relates them to the wall clock
+    start = std::chrono::steady_clock::now();
+    std::time_t now = std::time(nullptr);
+    std::array<char, 32> date{};
+    std::strftime(date.data(), date.size(), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    std::fprintf(file, "log started %s\n", date.data());
+    running.store(true, std::memory_order_release);
+    writer = std::thread(&Logger::run, this);
+    return true;
+}
+
+void Logger::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+    running.store(false, std::memory_order_release);
+    writer.join();
+    // messages that were published while the writer stopped
+    drain();
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        std::fprintf(file, "%llu messages dropped\n", static_cast<unsigned long long>(lost));
+    }
+    if (file == stderr) {
+        std::fflush(file);
+    } else {
+        std::fclose(file);
+    }
+    file = nullptr;
+}
+
+size_t Logger::drain() {
+    size_t n = 0;
+    while (true) {
+        LogRecord &record = (*records)[tail & (log_capacity - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != tail + 1) {
+            break;
+        }
+        line.clear();
+        std::format_to(std::back_inserter(line), "[{:>6}.{:06}] {:<5} ", record.micros / 1000000,
+                       record.micros % 1000000, toString(record.level));
+        line.append(record.text.data(), record.length);
+        line.push_back('\n');
+        record.sequence.store(tail + log_capacity, std::memory_order_release);
+        tail++;
+        std::fwrite(line.data(), 1, line.size(), file);
+        n++;
+    }
+    return n;
+}
+
+void Logger::run() {
+    while (running.load(std::memory_order_acquire)) {
+        if (drain() > 0) {
+            std::fflush(file);
+        } else {
+            std::this_thread::sleep_for(log_drain_interval);
+        }
+    }
+}
+
+} // namespace Mondfisch
@@ -0,0 +1,226 @@
+#include "match.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <unordered_map>
+
+namespace Mondfisch::Match {
+
+namespace {
+
+Move find_legal(Game &game, std::string_view notation) {
+    MoveList moves;
+    game.legal_moves(moves);
+    for (auto move : moves) {
+        if (move.move.toSimpleNotation() == notation) {
+            return move.move;
+        }
+    }
+    return Move{};
+}
+
+// time for a move of a side with the given clock in milliseconds
+uint64_t allot(int64_t clock, int64_t increment) {
+    int64_t time = std::min(clock / 20 + increment * 3 / 4, clock / 2);
+    return std::max<int64_t>(time, 1);
+}
+
+} // namespace
+
+Opening random_opening(uint32_t plies, uint64_t seed) {
+    while (true) {
+        Game game{};
+        game.loadStartingPos();
+        Opening opening{.fen = game.dumpFen()};
+        for (uint32_t i = 0; i < plies; i++) {
+            MoveList moves;
+            game.legal_moves(moves);
+            if (moves.empty()) {
+                break;
+            }
+            std::string move = moves[splitmix64(seed) % moves.size()].move.toSimpleNotation();
+            game.playMove(move);
+            opening.moves.push_back(std::move(move));
+        }
+        MoveList moves;
+        game.legal_moves(moves);
+        if (opening.moves.size() == plies && !moves.empty()) {
+            return opening;
+        }
+    }
+}
+
+GameRecord play(Api::Engine &white, Api::Engine &black, const Opening &opening,
+                const TimeControl &control) {
+    white.newGame();
+    black.newGame();
+    Game game{};
+    game.loadFen(opening.fen);
+
+    // both engines follow the game move by move instead of replaying it before every search
+    white.setPosition(opening.fen);
+    black.setPosition(opening.fen);
+
+    GameRecord record{.fen = opening.fen};
+    std::unordered_map<uint64_t, uint32_t> repetitions;
+    repetitions[game.hash]++;
+
+    // the game does not count the moves played on it
+    uint32_t moveNumber = std::max<uint32_t>(game.fullmoves, 1);
+    auto make = [&](Move move) {
+        if (game.color == WHITE || record.movetext.empty()) {
+            record.movetext += std::format("{}{}. ", record.movetext.empty() ? "" : " ",
+                                           moveNumber);
+            if (game.color == BLACK) {
+                record.movetext += "... ";
+            }
+        } else {
+            record.movetext += ' ';
+        }
+        record.movetext += game.toSan(move);
+        moveNumber += game.color == BLACK;
+        std::string notation = move.toSimpleNotation();
+        white.playMove(notation);
+        black.playMove(notation);
+        game.playMove(notation);
+        repetitions[game.hash]++;
+    };
+    for (const std::string &move : opening.moves) {
+        make(find_legal(game, move));
+    }
+
+    std::array<int64_t, 2> clocks{control.base, control.base};
+    uint32_t winStreak = 0;
+    int32_t winner = 0;
+    uint32_t drawStreak = 0;
+    for (uint32_t ply = 0;; ply++) {
+        MoveList legal;
+        game.legal_moves(legal);
+        if (legal.empty()) {
+            bool mate = game.is_check(game.color);
+            record.result = mate ? (game.color == WHITE ? -1 : 1) : 0;
+            record.termination = mate ? "checkmate" : "stalemate";
+            break;
+        }
+        if (game.halfmove >= 100 || repetitions[game.hash] >= 3 ||
+            game.is_insufficient_material()) {
+            record.termination = "draw by rule";
+            break;
+        }
+        if (ply >= max_plies) {
+            record.termination = "adjudication, move limit";
+            break;
+        }
+
+        uint8_t color = game.color;
+        Api::Engine &engine = color == WHITE ? white : black;
+        Api::Limits limits{};
+        if (control.base > 0) {
+            limits.movetime = allot(clocks[color], control.increment);
+        } else {
+            limits.nodes = control.nodes;
+        }
+        auto start = std::chrono::steady_clock::now();
+        Search::SearchResult result = engine.search(limits);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        if (control.base > 0) {
+            clocks[color] -= elapsed;
+            if (clocks[color] < 0) {
+                record.result = color == WHITE ? -1 : 1;
+                record.termination = "time forfeit";
+                break;
+            }
+            clocks[color] += control.increment;
+        }
+
+        // the score from the view of white
+        int32_t score = color == WHITE ? result.score : -result.score;
+        if (std::abs(score) >= resign_score && (winStreak == 0 || (score > 0) == (winner > 0))) {
+            winStreak++;
+            winner = score > 0 ? 1 : -1;
+        } else {
+            winStreak = 0;
+        }
+        drawStreak = ply + opening.moves.size() >= draw_start && std::abs(score) <= draw_score
+                         ? drawStreak + 1
+                         : 0;
+
+        make(result.bestMove == Move{} ? legal[0].move : result.bestMove);
+
+        if (winStreak >= resign_plies) {
+            record.result = winner;
+            record.termination = "adjudication, decisive score";
+            break;
+        }
+        if (drawStreak >= draw_plies) {
+            record.termination = "adjudication, drawn score";
+            break;
+        }
+    }
+    return record;
+}
+
+std::string_view result_string(int32_t result) {
+    return result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2";
+}
+
+std::string to_pgn(const GameRecord &record, uint32_t round, std::string_view white,
+                   std::string_view black) {
+    std::string pgn = std::format("[Event \"match\"]\n[Round \"{}\"]\n[White \"{}\"]\n"
+                                  "[Black \"{}\"]\n[Result \"{}\"]\n",
+                                  round, white, black, result_string(record.result));
+    pgn += std::format("[FEN \"{}\"]\n[SetUp \"1\"]\n", record.fen);
+    pgn += std::format("[Termination \"{}\"]\n\n", record.termination);
+    pgn += std::format("{} {}\n\n", record.movetext, result_string(record.result));
+    return pgn;
+}
+
+void Score::add(int32_t result) {
+    wins += result > 0;
+    losses += result < 0;
+    draws += result == 0;
+}
+
+double Score::mean() const { return games() > 0 ? (wins + draws * 0.5) / games() : 0.5; }
+
+double Score::variance() const {
+    if (games() == 0) {
+        return 0;
+    }
+    double s = mean();
+    return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+}
+
+double Score::error() const {
+    if (games() == 0) {
+        return 0;
+    }
+    double deviation = std::sqrt(variance() / games());
+    return (elo(mean() + 1.96 * deviation) - elo(mean() - 1.96 * deviation)) / 2;
+}
+
+double Score::llr(double elo0, double elo1) const {
+    double variance = this->variance();
+    if (variance <= 0) {
+        return 0;
+    }
+    double s0 = expected(elo0);
+    double s1 = expected(elo1);
+    return games() * (s1 - s0) * (2 * mean() - s0 - s1) / (2 * variance);
+}
+
+double Score::elo(double score) {
+    score = std::clamp(score, 1e-6, 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+double Score::expected(double elo) { return 1 / (1 + std::pow(10, -elo / 400)); }
+
+Sprt::Sprt(double alpha, double beta)
+    : lower(std::log(beta / (1 - alpha))), upper(std::log((1 - beta) / alpha)) {}
+
+} // namespace Mondfisch::Match
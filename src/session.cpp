@@ -0,0 +1,53 @@
+#include "session.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+namespace Mondfisch::Session {
+
+std::vector<Event> load(const std::string &filename) {
+    std::vector<Event> events;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find(' ');
+        if (first == std::string::npos || first + 2 >= line.size()) {
+            continue;
+        }
+        Event event{
+            .micros = std::strtoll(line.c_str(), nullptr, 10),
+            .direction = line[first + 1],
+            .line = line.size() > first + 3 ? line.substr(first + 3) : "",
+        };
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+bool is_search(std::string_view line) {
+    return line.starts_with("go") && !line.starts_with("go perft");
+}
+
+std::vector<double> recorded_latencies(const std::vector<Event> &events) {
+    std::vector<int64_t> gos;
+    std::vector<int64_t> bestmoves;
+    for (const Event &event : events) {
+        if (event.direction == '<' && is_search(event.line)) {
+            gos.push_back(event.micros);
+        } else if (event.direction == '>' && event.line.starts_with("bestmove")) {
+            bestmoves.push_back(event.micros);
+        }
+    }
+    std::vector<double> latencies;
+    for (size_t i = 0; i < gos.size(); i++) {
+        if (i >= bestmoves.size()) {
+            latencies.push_back(-1);
+            continue;
+        }
+        int64_t start = i > 0 ? std::max(gos[i], bestmoves[i - 1]) : gos[i];
+        latencies.push_back((bestmoves[i] - start) / 1000.0);
+    }
+    return latencies;
+}
+
+} // namespace Mondfisch::Session
@@ -1,4 +1,6 @@
 #include "uci.h"
+#include "bench.h"
+#include <algorithm>
 
 namespace Mondfisch {
 
@@ -8,18 +10,63 @@ void UciEngine::new_uci_game() {
     ctx.reset();
     ctx.table = &table;
     ctx.table->clear();
+    rng = rng_seed;
+    positionBase.clear();
+    positionMoves.clear();
 }
 
-Move choose_top_k(MoveList &moves, uint8_t k) {
+void UciEngine::set_position(std::stringstream &ss) {
+    std::string base;
+    std::string arg;
+    ss >> base;
+    if (base != "startpos" && base != "fen") {
+        return;
+    }
+    if (base == "fen") {
+        while (ss >> arg && arg != "moves") {
+            base += " " + arg;
+        }
+    } else {
+        ss >> arg;
+    }
+    std::vector<std::string> moves;
+    while (ss >> arg) {
+        moves.push_back(arg);
+    }
+
+    bool extends = base == positionBase && moves.size() >= positionMoves.size() &&
+                   std::equal(positionMoves.begin(), positionMoves.end(), moves.begin());
+    if (!extends) {
+        if (base == "startpos") {
+            game.loadStartingPos();
+        } else {
+            game.loadFen(base.substr(4));
+        }
+        positionBase = base;
+        positionMoves.clear();
+    }
+    for (size_t i = positionMoves.size(); i < moves.size(); i++) {
+        game.playMove(moves[i]);
+        positionMoves.push_back(std::move(moves[i]));
+    }
+}
+
+Move choose_top_k(MoveList &moves, uint8_t k, uint64_t &rng) {
+    if (moves.empty()) {
+        return Move{};
+    }
+    k = std::min<size_t>(k, moves.size());
     if (k <= 1) {
         return moves[0].move;
     }
-    return moves[std::rand() % k].move;
+    return moves[splitmix64(rng) % k].move;
 }
 
-Move simple_choose_move(MoveList &moves) { return moves[std::rand() % moves.size()].move; }
+Move simple_choose_move(MoveList &moves, uint64_t &rng) {
+    return moves[splitmix64(rng) % moves.size()].move;
+}
 
-Move choose_move(Search::SearchContext &ctx) {
+Move choose_move(Search::SearchContext &ctx, uint64_t &rng) {
     constexpr Search::Score window = 20;
     Search::Score treshold = ctx.moves[0].score;
     if (Search::is_mate(treshold)) {
@@ -37,7 +84,7 @@ Move choose_move(Search::SearchContext &ctx) {
         max += std::exp(score * 0.001f);
     }
 
-    float r = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / max));
+    float r = static_cast<float>(splitmix64(rng) >> 40) / static_cast<float>(1 << 24) * max;
 
     for (int32_t i = 0; i < (int32_t)ctx.moves.size(); i++) {
         int32_t score = ctx.moves[i].score;
@@ -50,7 +97,7 @@ Move choose_move(Search::SearchContext &ctx) {
 }
 
 void filter_move_canditates(MoveList &moves, Search::Score window, uint8_t k) {
-    moves.resize(k);
+    moves.resize(std::min<size_t>(k, moves.size()));
     for (uint16_t i = 1; i < moves.size(); i++) {
         if (moves[i].score < moves[0].score - window) {
             moves.remove_unordered(i);
@@ -61,12 +108,41 @@ void filter_move_canditates(MoveList &moves, Search::Score window, uint8_t k) {
 }
 
 void UciEngine::think() {
+    if (ctx.nodeLimit > 0) {
+        // node limited searches have to be reproducible, nothing may leak in from earlier searches
+        ctx.table->clear();
+        ctx.gen = 0;
+        rng = rng_seed;
+    }
     ctx.startTimer();
+    logger.info("go depth {} nodes {} time {}", depth, ctx.nodeLimit, ctx.thinkingTime);
 
-    Search::iterative_deepening(ctx, game, depth);
+    lastResult = Search::iterative_deepening(ctx, game, depth);
+    const Search::SearchResult &result = lastResult;
+    if (IO::json) {
+        for (uint32_t i = 0; i < std::min<size_t>(kBest, ctx.moves.size()); i++) {
+            IO::sendMultiPvJson(i + 1, ctx.moves[i]);
+        }
+    }
     filter_move_canditates(ctx.moves, 20, kBest);
-    Move best = choose_top_k(ctx.moves, kBest);
+    Move best = choose_top_k(ctx.moves, kBest, rng);
+    if (IO::json) {
+        IO::sendResultJson(result, best);
+    }
     IO::sendBestMove(best);
+
+    if (!logger.enabled(LogLevel::INFO)) {
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - ctx.timeStart)
+                       .count();
+    logger.info("bestmove {} depth {} nodes {} time {}", best.toSimpleNotation(), result.depth,
+                ctx.nodes, elapsed);
+    if (ctx.thinkingTime > 0 && uint64_t(elapsed) > ctx.thinkingTime) {
+        logger.warn("time overshoot {}ms of {}ms", elapsed - int64_t(ctx.thinkingTime),
+                    ctx.thinkingTime);
+    }
 }
 
 uint64_t calc_safe_move_time(uint64_t time) {
@@ -99,97 +175,134 @@ uint64_t UciEngine::calc_time() {
     return target;
 }
 
+void UciEngine::set_option(const std::string &name, const std::string &value) {
+    if (name == "Hash") {
+        table.setsize(std::stoul(value));
+    } else if (name == "MultiPV") {
+        kBest = std::stoul(value);
+    } else if (name == "LmrBase" || name == "LmrDivisor") {
+        ctx.params.set(name, std::stoi(value));
+    } else if (name == "SearchVariant") {
+        ctx.params.setVariant(value);
+    } else if (name == "LogFile") {
+        logFile = value == "<empty>" ? "" : value;
+        configure_logger();
+    } else if (name == "LogLevel") {
+        logLevel = log_level_from_string(value);
+        configure_logger();
+    } else if (name == "JsonOutput") {
+        IO::json = value == "true";
+    }
+}
+
+void UciEngine::configure_logger() {
+    if (logFile.empty() && !debug) {
+        logger.close();
+        return;
+    }
+    if (!logger.open(logFile)) {
+        IO::sendString("can not open log file " + logFile);
+        return;
+    }
+    logger.setLevel(debug ? LogLevel::DEBUG : logLevel);
+}
+
 void UciEngine::loop() {
     std::string inp;
-    while (1) {
-        if (!IO::recv(inp)) {
-            continue;
-        }
-        std::stringstream ss(inp);
-        std::string cmd;
-        std::string arg;
-        std::getline(ss, cmd, ' ');
-        if (cmd == "uci") {
-            IO::sendId();
-            IO::sendOptions();
-            IO::sendUciOk();
-        } else if (cmd == "isready") {
-            IO::sendReadyOk();
-        } else if (cmd == "ucinewgame") {
-            new_uci_game();
-        } else if (cmd == "position") {
-            std::getline(ss, arg, ' ');
-            if (arg == "fen") {
-                game.loadFen(ss);
-            } else if (arg == "startpos") {
-                game.loadStartingPos();
-            }
-            std::getline(ss, arg, ' ');
-            if (arg == "moves") {
-                while (std::getline(ss, arg, ' ')) {
-                    game.playMove(arg);
-                }
-            }
+    // a closed stdin ends the session like quit
+    while (IO::recv(inp) && handle(inp)) {
+    }
+}
 
-        } else if (cmd == "go") {
-            ss >> cmd;
-            if (cmd == "perft") {
-                uint32_t n;
-                ss >> n;
-                perftInfo(game, n);
-            } else {
-                depth = -1;
-                timeValues = TimeManagement{};
-                do {
-                    if (cmd == "depth") {
-                        ss >> depth;
-                    } else if (cmd == "movetime") {
-                        ss >> timeValues.movetime;
-                    } else if (cmd == "wtime") {
-                        ss >> timeValues.wtime;
-                    } else if (cmd == "btime") {
-                        ss >> timeValues.btime;
-                    } else if (cmd == "winc") {
-                        ss >> timeValues.winc;
-                    } else if (cmd == "binc") {
-                        ss >> timeValues.binc;
-                    }
-                } while (ss >> cmd);
-                if (timeValues.movetime != -1) {
-                    ctx.thinkingTime = timeValues.movetime =
-                        calc_safe_move_time(timeValues.movetime);
-                } else if (depth == -1) {
-                    ctx.thinkingTime = calc_time();
-                }
-                if (depth == -1) {
-                    depth = Search::max_depth;
+bool UciEngine::handle(const std::string &inp) {
+    logger.debug("<< {}", inp);
+    std::stringstream ss(inp);
+    std::string cmd;
+    std::string arg;
+    std::getline(ss, cmd, ' ');
+    if (cmd == "uci") {
+        IO::sendId();
+        IO::sendOptions();
+        IO::sendUciOk();
+    } else if (cmd == "isready") {
+        IO::sendReadyOk();
+    } else if (cmd == "ucinewgame") {
+        new_uci_game();
+    } else if (cmd == "position") {
+        set_position(ss);
+    } else if (cmd == "go") {
+        ss >> cmd;
+        if (cmd == "perft") {
+            uint32_t n;
+            ss >> n;
+            perftInfo(game, n);
+        } else {
+            depth = -1;
+            timeValues = TimeManagement{};
+            ctx.thinkingTime = 0;
+            ctx.nodeLimit = 0;
+            ctx.mateLimit = 0;
+            do {
+                if (cmd == "depth") {
+                    ss >> depth;
+                } else if (cmd == "nodes") {
+                    ss >> ctx.nodeLimit;
+                } else if (cmd == "mate") {
+                    ss >> ctx.mateLimit;
+                } else if (cmd == "movetime") {
+                    ss >> timeValues.movetime;
+                } else if (cmd == "wtime") {
+                    ss >> timeValues.wtime;
+                } else if (cmd == "btime") {
+                    ss >> timeValues.btime;
+                } else if (cmd == "winc") {
+                    ss >> timeValues.winc;
+                } else if (cmd == "binc") {
+                    ss >> timeValues.binc;
                 }
-                think();
+            } while (ss >> cmd);
+            if (timeValues.movetime != -1) {
+                ctx.thinkingTime = timeValues.movetime =
+                    calc_safe_move_time(timeValues.movetime);
+            } else if (depth == -1 && ctx.nodeLimit == 0 && ctx.mateLimit == 0) {
+                ctx.thinkingTime = calc_time();
             }
-        } else if (cmd == "setoption") {
-            ss >> cmd;
-            if (cmd == "Hash") {
-                uint32_t n;
-                ss >> n;
-                table.setsize(n);
-            } else if (cmd == "MultiPV") {
-                uint32_t n;
-                ss >> n;
-                kBest = n;
-            }
-        } else if (cmd == "stop") {
-            ctx.stop = true;
-        } else if (cmd == "quit") {
-            break;
-        } else if (cmd == "debug") {
-        } else if (cmd == "show") {
-            std::getline(ss, arg, ' ');
-            if (arg == "all") {
-                game.showAll();
-            } else {
-                game.showBoard();
+            if (depth == -1) {
+                depth = Search::max_depth;
             }
+            think();
+        }
+    } else if (cmd == "setoption") {
+        std::string name;
+        std::string value;
+        ss >> arg;
+        while (ss >> arg && arg != "value") {
+            name += name.empty() ? arg : " " + arg;
+        }
+        ss >> value;
+        set_option(name, value);
+    } else if (cmd == "bench") {
+        uint32_t benchDepth = Bench::default_depth;
+        uint32_t benchHash = Bench::default_hash;
+        uint32_t benchThreads = Bench::default_threads;
+        ss >> benchDepth >> benchHash >> benchThreads;
+        Bench::run(benchDepth, benchHash, benchThreads, ctx.params);
+    } else if (cmd == "stop") {
+        ctx.stop = true;
+    } else if (cmd == "quit") {
+        return false;
+    } else if (cmd == "debug") {
+        ss >> arg;
+        debug = arg == "on";
+        configure_logger();
+    } else if (cmd == "show") {
+        std::getline(ss, arg, ' ');
+        if (arg == "all") {
+            game.showAll();
+        } else {
+            game.showBoard();
         }
     }
+    return true;
 }
 } // namespace Mondfisch
@@ -1,15 +1,30 @@
+#include "api.h"
+#include "batch.h"
+#include "bench.h"
 #include "engine_search.h"
+#include "epd.h"
+#include "evaluation.h"
 #include "game.h"
+#include "logger.h"
+#include "match.h"
+#include "mondfisch.h"
+#include "session.h"
+#include "uci.h"
+#include <algorithm>
+#include <atomic>
 #include <bit>
 #include <cassert>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <cstdlib>
 #include <fstream>
+#include <new>
 #include <print>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 TEST_CASE("Computing valid positions", "[perft]") {
     Mondfisch::initConstants();
@@ -111,6 +126,100 @@ TEST_CASE("SEE Tests", "[see]") {
     }
 }
 
+Mondfisch::Move find_move(Mondfisch::Game &game, const std::string &notation) {
+    Mondfisch::MoveList moves;
+    game.pseudo_legal_moves(moves);
+    for (auto move : moves) {
+        if (move.move.toSimpleNotation() == notation) {
+            return move.move;
+        }
+    }
+    return Mondfisch::Move{};
+}
+
+TEST_CASE("SEE threshold tests", "[see]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+
+    SECTION("Thresholds around the exchange value") {
+        game.loadFen("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+        REQUIRE(game.see_ge(find_move(game, "e1e5"), 100));
+        REQUIRE_FALSE(game.see_ge(find_move(game, "e1e5"), 101));
+
+        game.loadFen("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+        REQUIRE(game.see_ge(find_move(game, "d3e5"), -220));
+        REQUIRE_FALSE(game.see_ge(find_move(game, "d3e5"), -219));
+    }
+
+    SECTION("En passant") {
+        game.loadFen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+        REQUIRE(game.see_ge(find_move(game, "e5d6"), 100));
+        REQUIRE_FALSE(game.see_ge(find_move(game, "e5d6"), 101));
+    }
+
+    SECTION("Promotions") {
+        game.loadFen("3r3k/4P3/8/8/8/8/8/4K3 w - - 0 1");
+        REQUIRE(game.see_ge(find_move(game, "e7d8q"), 1300));
+        REQUIRE_FALSE(game.see_ge(find_move(game, "e7d8q"), 1301));
+        // the rook takes the new queen
+        REQUIRE(game.see_ge(find_move(game, "e7e8q"), -100));
+        REQUIRE_FALSE(game.see_ge(find_move(game, "e7e8q"), 0));
+    }
+
+    SECTION("Agrees with the full swap list") {
+        for (auto fen : Mondfisch::Bench::positions) {
+            game.loadFen(std::string(fen));
+            Mondfisch::MoveList moves;
+            game.pseudo_legal_captures(moves);
+            for (auto move : moves) {
+                if (move.move.flags != Mondfisch::MoveType::MOVE_CAPTURE ||
+                    move.move.promote != Mondfisch::Piece::NONE) {
+                    continue;
+                }
+                int32_t value = game.see(move.move.from, move.move.to, game.color);
+                for (int32_t threshold : {-500, -100, 0, 1, 100, 220, 500}) {
+                    INFO(fen << " " << move.move.toSimpleNotation() << " " << threshold);
+                    REQUIRE(game.see_ge(move.move, threshold) == (value >= threshold));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Attack maps", "[attacks]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+
+    // the cached maps of the current position against the single square test
+    auto check = [&]() {
+        const Mondfisch::AttackInfo &info = game.attack_info();
+        for (uint8_t side = 0; side < 2; side++) {
+            Mondfisch::BitBoard expected = 0;
+            for (Mondfisch::Position pos = 0; pos < 64; pos++) {
+                if (game.is_sqaure_attacked(pos, side)) {
+                    expected |= Mondfisch::position_to_bitboard(pos);
+                }
+            }
+            INFO(game.dumpFen() << " side " << int(side));
+            REQUIRE(info.attacks[side] == expected);
+        }
+    };
+
+    for (auto fen : Mondfisch::Bench::positions) {
+        game.loadFen(std::string(fen));
+        check();
+        // the cache follows the position through make and undo
+        Mondfisch::MoveList moves;
+        game.legal_moves(moves);
+        for (auto move : moves) {
+            game.make_move(move.move);
+            check();
+            game.undo_move(move.move);
+        }
+        check();
+    }
+}
+
 TEST_CASE("Zobrist Hashing Quality Tests", "[hashing]") {
     Mondfisch::initConstants();
     Mondfisch::Game game{};
@@ -212,20 +321,788 @@ TEST_CASE("Zobrist Hashing Quality Tests", "[hashing]") {
     }
 }
 
-/*std::string epd_to_fen_fast(const std::string &epd) {
-    size_t pos = 0;
-    for (int i = 0; i < 4; ++i) {
-        pos = epd.find(' ', pos + 1);
-        if (pos == std::string::npos)
-            break;
+TEST_CASE("Node limited search", "[search]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+    Mondfisch::Search::TranspositionTable table{};
+    table.setsize(1);
+
+    Mondfisch::Search::SearchContext ctx{};
+    auto run = [&](const std::string &fen) {
+        game.loadFen(fen);
+        ctx.reset();
+        ctx.table = &table;
+        table.clear();
+        ctx.nodeLimit = 20000;
+        ctx.startTimer();
+        return Mondfisch::Search::iterative_deepening(ctx, game, Mondfisch::Search::max_depth);
+    };
+
+    const std::string p1 = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    SECTION("Node budget is exact") {
+        run(p1);
+        REQUIRE(ctx.nodes == ctx.nodeLimit);
+    }
+
+    SECTION("Repeated runs are identical") {
+        auto first = run(p1);
+        run("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+        auto second = run(p1);
+        REQUIRE(first.bestMove == second.bestMove);
+        REQUIRE(first.score == second.score);
+        REQUIRE(first.nodes == second.nodes);
+        REQUIRE(first.depth == second.depth);
+    }
+}
+
+TEST_CASE("Principal variation", "[search]") {
+    Mondfisch::Api::Engine engine{16};
+    std::vector<Mondfisch::Search::SearchResult> iterations;
+    auto collect = [&](const Mondfisch::Search::SearchResult &result) {
+        iterations.push_back(result);
+    };
+
+    const std::string kiwipete =
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    const std::vector<std::string_view> opening{"e2e4", "e7e5"};
+    using Line = std::pair<std::string_view, std::span<const std::string_view>>;
+    for (const auto &[fen, moves] : {Line{kiwipete, {}}, Line{"", opening}}) {
+        REQUIRE(engine.setPosition(fen, moves));
+        iterations.clear();
+        engine.search({.depth = 9}, collect);
+        REQUIRE(iterations.back().depth == 9);
+        // table cutoffs in pv nodes must not cut the line short
+        REQUIRE(iterations.back().pvLength >= 7);
+
+        for (const auto &result : iterations) {
+            INFO("depth " << result.depth);
+            REQUIRE(result.pvLength > 0);
+            REQUIRE(result.pv[0] == result.bestMove);
+            Mondfisch::Game game = engine.game;
+            for (Mondfisch::Move move : result.pvMoves()) {
+                Mondfisch::MoveList legal;
+                game.legal_moves(legal);
+                REQUIRE(std::any_of(legal.begin(), legal.end(),
+                                    [&](const Mondfisch::ScoreMove &m) { return m.move == move; }));
+                game.make_move(move);
+            }
+        }
+    }
+}
+
+TEST_CASE("Search variants", "[search]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+    Mondfisch::Search::TranspositionTable table{};
+    table.setsize(1);
+
+    Mondfisch::Search::SearchContext ctx{};
+    auto run = [&](const std::string &fen, uint32_t depth) {
+        game.loadFen(fen);
+        ctx.reset();
+        ctx.table = &table;
+        table.clear();
+        ctx.report = false;
+        ctx.startTimer();
+        return Mondfisch::Search::iterative_deepening(ctx, game, depth);
+    };
+
+    SECTION("Selecting by name") {
+        Mondfisch::Search::SearchParams params{};
+        REQUIRE(params.variantName() == "Default");
+        REQUIRE(params.setVariant("NoLmr"));
+        REQUIRE(params.variantName() == "NoLmr");
+        REQUIRE_FALSE(params.setVariant("NoSuchVariant"));
+        REQUIRE(params.variantName() == "NoLmr");
+    }
+
+    SECTION("Every variant finds the mate") {
+        const std::string mateInTwo =
+            "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 0";
+        for (uint8_t i = 0; i < Mondfisch::Search::search_variants.size(); i++) {
+            ctx.params.variant = i;
+            auto result = run(mateInTwo, 6);
+            INFO(ctx.params.variantName());
+            REQUIRE(Mondfisch::Search::mate_in(result.score) == 2);
+        }
+    }
+
+    SECTION("Disabled pruning searches more nodes") {
+        const std::string fen =
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+        ctx.params.setVariant("Default");
+        run(fen, 6);
+        uint64_t pruned = ctx.nodes;
+        ctx.params.setVariant("NoPruning");
+        run(fen, 6);
+        REQUIRE(ctx.nodes > pruned);
+    }
+}
+
+TEST_CASE("Bench signature", "[search]") {
+    Mondfisch::initConstants();
+    // a change of this count is a change of the search, refactorings must keep it
+    Mondfisch::IO::out = nullptr;
+    Mondfisch::Bench::BenchResult result = Mondfisch::Bench::run(6, 16, 1);
+    Mondfisch::IO::out = stdout;
+    REQUIRE(result.nodes == 529275);
+}
+
+TEST_CASE("Position command", "[uci]") {
+    Mondfisch::initConstants();
+    Mondfisch::UciEngine engine{};
+    auto position = [&](const std::string &args) {
+        std::stringstream ss(args);
+        engine.set_position(ss);
+    };
+
+    SECTION("Extending the move list matches a full replay") {
+        position("startpos moves e2e4 e7e5 g1f3");
+        position("startpos moves e2e4 e7e5 g1f3 b8c6 f1b5");
+        uint64_t incremental = engine.game.hash;
+        position("fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 moves e2e4");
+        position("startpos moves e2e4 e7e5 g1f3 b8c6 f1b5");
+        REQUIRE(engine.game.hash == incremental);
+        REQUIRE(engine.game.history.size() == 5);
+        REQUIRE(engine.game.undoStack.size() == 0);
+    }
+
+    SECTION("Games longer than the reserved history") {
+        std::string moves = "startpos moves";
+        for (int i = 0; i < 600; i++) {
+            moves += " g1f3 g8f6 f3g1 f6g8";
+        }
+        position(moves);
+        position(moves + " e2e4");
+        REQUIRE(engine.game.history.size() == 2401);
+        REQUIRE(engine.game.color == Mondfisch::BLACK);
+    }
+}
+
+namespace {
+std::atomic<bool> countAllocations = false;
+std::atomic<uint64_t> allocations = 0;
+} // namespace
+
+void *operator new(std::size_t size) {
+    if (countAllocations) {
+        allocations++;
+    }
+    if (void *ptr = std::malloc(size > 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+TEST_CASE("Search does not allocate", "[search]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+    Mondfisch::Search::TranspositionTable table{};
+    table.setsize(1);
+
+    Mondfisch::Search::SearchContext ctx{};
+    ctx.reset();
+    ctx.table = &table;
+    game.loadFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    ctx.startTimer();
+
+    // the search reports every iteration, with SEARCH_STATS also its statistics
+    allocations = 0;
+    countAllocations = true;
+    auto result = Mondfisch::Search::iterative_deepening(ctx, game, 6);
+    countAllocations = false;
+
+    REQUIRE(result.depth == 6);
+    REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Session recording", "[session]") {
+    Mondfisch::initConstants();
+    using Mondfisch::Session::Event;
+
+    SECTION("Queued gos belong to the bestmoves in order") {
+        // input is stamped on arrival, the second and third go wait for the first search
+        std::vector<Event> events{
+            {0, '<', "go movetime 50"},         {1000, '<', "go movetime 60"},
+            {2000, '<', "go perft 2"},          {3000, '<', "go movetime 60"},
+            {55300, '>', "bestmove e2e4"},      {60000, '>', "Nodes searched: 400"},
+            {121300, '>', "bestmove d2d4"},     {187300, '>', "bestmove g1f3"},
+        };
+        auto latencies = Mondfisch::Session::recorded_latencies(events);
+        REQUIRE(latencies.size() == 3);
+        REQUIRE_THAT(latencies[0], Catch::Matchers::WithinAbs(55.3, 1e-9));
+        REQUIRE_THAT(latencies[1], Catch::Matchers::WithinAbs(66, 1e-9));
+        REQUIRE_THAT(latencies[2], Catch::Matchers::WithinAbs(66, 1e-9));
+
+        events.pop_back();
+        REQUIRE(Mondfisch::Session::recorded_latencies(events).back() == -1);
+    }
+
+    SECTION("Record and replay") {
+        const std::string filename = "session_test.log";
+        const std::vector<std::string> commands{"isready", "position startpos", "go depth 4",
+                                                "position startpos moves e2e4", "go nodes 3000",
+                                                "go depth 3"};
+        REQUIRE(Mondfisch::IO::record(filename));
+        Mondfisch::IO::out = nullptr;
+        std::vector<std::string> played;
+        {
+            Mondfisch::UciEngine engine{};
+            for (const std::string &command : commands) {
+                // the input thread records the lines read from stdin
+                Mondfisch::IO::recordLine('<', command);
+                engine.handle(command);
+                if (Mondfisch::Session::is_search(command)) {
+                    played.push_back(engine.lastResult.bestMove.toSimpleNotation());
+                }
+            }
+        }
+        std::fclose(Mondfisch::IO::session);
+        Mondfisch::IO::session = nullptr;
+        Mondfisch::IO::out = stdout;
+
+        auto events = Mondfisch::Session::load(filename);
+        std::vector<std::string> input;
+        std::vector<std::string> bestmoves;
+        for (const Event &event : events) {
+            if (event.direction == '<') {
+                input.push_back(event.line);
+            } else if (event.line.starts_with("bestmove ")) {
+                bestmoves.push_back(event.line.substr(9));
+            }
+        }
+        REQUIRE(input == commands);
+        REQUIRE(bestmoves == played);
+        REQUIRE(std::is_sorted(events.begin(), events.end(), [](const Event &a, const Event &b) {
+            return a.micros < b.micros;
+        }));
+        auto latencies = Mondfisch::Session::recorded_latencies(events);
+        REQUIRE(latencies.size() == 3);
+        for (double latency : latencies) {
+            REQUIRE(latency >= 0);
+        }
+
+        // a fresh engine fed with the recorded input searches the same moves
+        Mondfisch::IO::out = nullptr;
+        std::vector<std::string> replayed;
+        {
+            Mondfisch::UciEngine engine{};
+            for (const Event &event : events) {
+                if (event.direction == '<') {
+                    engine.handle(event.line);
+                    if (Mondfisch::Session::is_search(event.line)) {
+                        replayed.push_back(engine.lastResult.bestMove.toSimpleNotation());
+                    }
+                }
+            }
+        }
+        Mondfisch::IO::out = stdout;
+        REQUIRE(replayed == played);
+        std::remove(filename.c_str());
+    }
+}
+
+// the lines the engine writes while f runs
+template <typename F> std::vector<std::string> capture_output(F &&f) {
+    std::FILE *file = std::tmpfile();
+    Mondfisch::IO::out = file;
+    f();
+    Mondfisch::IO::out = stdout;
+    std::rewind(file);
+    std::vector<std::string> lines;
+    std::string line;
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        if (c == '\n') {
+            lines.push_back(std::move(line));
+            line.clear();
+        } else {
+            line.push_back(char(c));
+        }
+    }
+    std::fclose(file);
+    return lines;
+}
+
+TEST_CASE("Search output", "[uci]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+    game.loadStartingPos();
+
+    SECTION("Info lines") {
+        Mondfisch::Search::SearchResult result{
+            .score = 23,
+            .nodes = 1000,
+            .pv = {find_move(game, "e2e4"), find_move(game, "g1f3")},
+            .pvLength = 2,
+            .depth = 5,
+            .selDepth = 8,
+            .elapsed = 20,
+        };
+        auto lines = capture_output([&]() {
+            Mondfisch::IO::sendSearchInfo(result, 12);
+            result.score = Mondfisch::Search::mate - 3;
+            result.pvLength = 0;
+            Mondfisch::IO::sendSearchInfo(result, 12);
+            result.score = -Mondfisch::Search::mate + 2;
+            result.elapsed = 0;
+            Mondfisch::IO::sendSearchInfo(result, 12);
+        });
+        REQUIRE(lines == std::vector<std::string>{
+                             "info depth 5 seldepth 8 score cp 23 nodes 1000 nps 50000 time 20 "
+                             "hashfull 12 pv e2e4 g1f3",
+                             "info depth 5 seldepth 8 score mate 2 nodes 1000 nps 50000 time 20 "
+                             "hashfull 12",
+                             "info depth 5 seldepth 8 score mate -1 nodes 1000 nps 0 time 0 "
+                             "hashfull 12",
+                         });
+    }
+
+    SECTION("Reports are throttled") {
+        Mondfisch::UciEngine engine{};
+        auto lines = capture_output([&]() {
+            engine.handle("position startpos");
+            engine.handle("go depth 9");
+        });
+        std::vector<std::pair<uint32_t, int64_t>> reports;
+        for (const std::string &line : lines) {
+            std::stringstream ss(line);
+            std::string token;
+            uint32_t depth = 0;
+            int64_t time = -1;
+            while (ss >> token) {
+                if (token == "depth") {
+                    ss >> depth;
+                } else if (token == "time") {
+                    ss >> time;
+                }
+            }
+            if (line.starts_with("info depth") && time >= 0) {
+                reports.emplace_back(depth, time);
+            }
+        }
+        REQUIRE(lines.back() == "bestmove " + engine.lastResult.bestMove.toSimpleNotation());
+        REQUIRE(reports.size() >= 2);
+        // the first iteration is always reported, the last one is reported late if it was held back
+        REQUIRE(reports.front().first == 1);
+        REQUIRE(reports.back().first == 9);
+        for (size_t i = 1; i + 1 < reports.size(); i++) {
+            INFO("report " << i);
+            REQUIRE(reports[i].second - reports[i - 1].second >=
+                    Mondfisch::Search::report_interval.count());
+        }
+    }
+
+    SECTION("Json events") {
+        // the keys of every event, as documented above IO
+        const std::unordered_map<std::string, std::vector<std::string>> schema{
+            {"iteration",
+             {"depth", "seldepth", "score", "nodes", "nps", "time", "hashfull", "pv"}},
+            {"stats", {"depth", "nodes", "hashfull"}},
+            {"multipv", {"rank", "move", "score", "bound"}},
+            {"result", {"bestmove", "depth", "score", "nodes", "nps", "time"}},
+            {"bench_position", {"position", "bestmove", "nodes"}},
+            {"bench", {"variant", "time", "nodes", "nps"}},
+        };
+        auto event = [](const std::string &line) {
+            size_t start = line.find("\"event\": \"") + 10;
+            return line.substr(start, line.find('"', start) - start);
+        };
+
+        Mondfisch::UciEngine engine{};
+        auto lines = capture_output([&]() {
+            engine.handle("setoption name JsonOutput value true");
+            engine.handle("setoption name MultiPV value 3");
+            engine.handle("position startpos");
+            engine.handle("go depth 5");
+            engine.handle("bench 1");
+            engine.handle("setoption name JsonOutput value false");
+        });
+        std::vector<std::string> events;
+        for (const std::string &line : lines) {
+            INFO(line);
+            if (!line.starts_with('{')) {
+                REQUIRE(line.starts_with("bestmove "));
+                events.push_back("bestmove");
+                continue;
+            }
+            REQUIRE(line.ends_with('}'));
+            events.push_back(event(line));
+            REQUIRE(schema.contains(events.back()));
+            for (const std::string &key : schema.at(events.back())) {
+                REQUIRE(line.find('"' + key + "\": ") != std::string::npos);
+            }
+        }
+
+        REQUIRE(std::count(events.begin(), events.end(), "multipv") == 3);
+        REQUIRE(std::count(events.begin(), events.end(), "bench_position") ==
+                Mondfisch::Bench::positions.size());
+        REQUIRE(events.back() == "bench");
+        // every iteration is followed by its stats, the result comes right before bestmove
+        for (size_t i = 0; i < events.size(); i++) {
+            if (events[i] == "iteration") {
+                REQUIRE(events[i + 1] == "stats");
+            } else if (events[i] == "bestmove") {
+                REQUIRE(events[i - 1] == "result");
+            }
+        }
+    }
+}
+
+TEST_CASE("Library interface", "[api]") {
+    mf_engine *engine = mf_engine_create(1);
+
+    SECTION("Position from fen and moves") {
+        const char *moves[] = {"e2e4", "e7e5", "g1f3"};
+        REQUIRE(mf_set_position(engine, nullptr, moves, 3));
+        const char *illegal[] = {"e2e4", "e2e4"};
+        REQUIRE_FALSE(mf_set_position(engine, nullptr, illegal, 2));
+        // a lone king against a queen is lost for the side to move
+        REQUIRE(mf_set_position(engine, "4k3/8/8/8/8/8/8/3QK3 b - - 0 1", nullptr, 0));
+        REQUIRE(mf_evaluate(engine) < -500);
+    }
+
+    SECTION("Invalid fens are rejected") {
+        REQUIRE(mf_set_position(engine, "4k3/8/8/8/8/8/8/3QK3 w - - 0 1", nullptr, 0));
+        for (const char *fen : {"8/8/8/8/8/8/8/8 w - - 0 1", "4k3/8/8/8/8/8/8/3QK3 x - - 0 1",
+                                "4k3/8/8/8/8/8/8/3QKK2 w - - 0 1",
+                                "4k3/8/8/8/8/8/8/3QK33 w - - 0 1", "4k3/8/8/8/8/8/3QK3 w - - 0 1",
+                                "4k3/8/8/8/8/8/8/3QK3 w - - 0 99999999999",
+                                "P3k3/8/8/8/8/8/8/3QK3 w - - 0 1", "4k3/8/8/8/8/8/8/3QK3 w X - 0 1",
+                                "4k3/8/8/8/8/8/8/3QK3 w - e4 0 1"}) {
+            INFO(fen);
+            REQUIRE_FALSE(mf_set_position(engine, fen, nullptr, 0));
+        }
+        // the position is kept and the counters are optional
+        REQUIRE(mf_evaluate(engine) > 500);
+        REQUIRE(mf_set_position(engine, "4k3/8/8/8/8/8/8/3QK3 b", nullptr, 0));
+        REQUIRE(mf_evaluate(engine) < -500);
+    }
+
+    SECTION("Search with info callback") {
+        mf_set_position(engine, "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1", nullptr, 0);
+        mf_limits limits{.depth = 6, .nodes = 0, .movetime = 0, .mate = 0};
+        uint32_t infos = 0;
+        auto callback = [](const mf_result *info, void *data) {
+            REQUIRE(info->pv_length > 0);
+            (*static_cast<uint32_t *>(data))++;
+        };
+        mf_result result;
+        mf_search(engine, &limits, callback, &infos, &result);
+        REQUIRE(infos > 0);
+        REQUIRE(std::string(result.bestmove) == "d1d8");
+        REQUIRE(std::string(result.pv[0]) == "d1d8");
+        REQUIRE(result.mate == 1);
+    }
+
+    SECTION("Positions without legal moves") {
+        mf_limits limits{.depth = 3, .nodes = 0, .movetime = 0, .mate = 0};
+        mf_result result;
+        REQUIRE(mf_set_position(engine, "7k/6Q1/6K1/8/8/8/8/8 b - - 0 1", nullptr, 0));
+        REQUIRE(mf_search(engine, &limits, nullptr, nullptr, &result));
+        REQUIRE(result.status == MF_STATUS_CHECKMATE);
+        REQUIRE(std::string(result.bestmove) == "0000");
+        REQUIRE(result.pv_length == 0);
+
+        REQUIRE(mf_set_position(engine, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", nullptr, 0));
+        REQUIRE(mf_search(engine, &limits, nullptr, nullptr, &result));
+        REQUIRE(result.status == MF_STATUS_STALEMATE);
+        REQUIRE(std::string(result.bestmove) == "0000");
+        REQUIRE(result.score == 0);
+
+        REQUIRE(mf_set_position(engine, nullptr, nullptr, 0));
+        REQUIRE(mf_search(engine, &limits, nullptr, nullptr, &result));
+        REQUIRE(result.status == MF_STATUS_OK);
+    }
+
+    SECTION("Moves played one by one") {
+        Mondfisch::Api::Engine api{1};
+        const std::vector<std::string_view> moves{"e2e4", "e7e5", "g1f3"};
+        REQUIRE(api.setPosition("", moves));
+        std::string fen = api.game.dumpFen();
+        REQUIRE(api.setPosition(""));
+        for (std::string_view move : moves) {
+            REQUIRE(api.playMove(move));
+        }
+        REQUIRE_FALSE(api.playMove("e2e4"));
+        REQUIRE(api.game.dumpFen() == fen);
+    }
+
+    SECTION("A search without a completed iteration returns a legal move") {
+        Mondfisch::Api::Engine api{1};
+        api.setPosition("");
+        auto result = api.search({.nodes = 1});
+        REQUIRE(result.depth == 0);
+        Mondfisch::MoveList moves;
+        api.game.legal_moves(moves);
+        REQUIRE(std::any_of(moves.begin(), moves.end(), [&](const Mondfisch::ScoreMove &move) {
+            return move.move == result.bestMove;
+        }));
+    }
+
+    SECTION("Stopping a background search") {
+        mf_limits limits{};
+        mf_start(engine, &limits, nullptr, nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        mf_stop(engine);
+        mf_result result;
+        mf_wait(engine, &result);
+        REQUIRE(result.depth > 0);
+        REQUIRE(result.depth < Mondfisch::Search::max_depth);
+    }
+
+    SECTION("Engines search independently") {
+        Mondfisch::Api::Engine first{1};
+        Mondfisch::Api::Engine second{1};
+        first.setPosition("");
+        second.setPosition("");
+        first.start({.nodes = 20000});
+        second.start({.nodes = 20000});
+        REQUIRE(first.wait().bestMove == second.wait().bestMove);
+    }
+
+    mf_engine_destroy(engine);
+}
+
+TEST_CASE("Standard algebraic notation", "[san]") {
+    Mondfisch::initConstants();
+    Mondfisch::Game game{};
+
+    SECTION("Pieces, pawns and captures") {
+        game.loadStartingPos();
+        REQUIRE(game.parseSan("Nf3") == find_move(game, "g1f3"));
+        REQUIRE(game.parseSan("e4") == find_move(game, "e2e4"));
+        REQUIRE(game.parseSan("Ne4") == Mondfisch::Move{});
+        game.loadFen("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+        REQUIRE(game.parseSan("exd5") == find_move(game, "e4d5"));
+        REQUIRE(game.parseSan("Bb5+") == find_move(game, "f1b5"));
+    }
+
+    SECTION("Disambiguation") {
+        game.loadFen("4k3/8/8/8/8/R7/8/R1R1K2N w - - 0 1");
+        REQUIRE(game.parseSan("Rb1") == Mondfisch::Move{});
+        REQUIRE(game.parseSan("Rab1") == find_move(game, "a1b1"));
+        REQUIRE(game.parseSan("Rcb1") == find_move(game, "c1b1"));
+        REQUIRE(game.parseSan("Ra2") == Mondfisch::Move{});
+        REQUIRE(game.parseSan("R1a2") == find_move(game, "a1a2"));
+        REQUIRE(game.parseSan("Ra3a2") == find_move(game, "a3a2"));
+        REQUIRE(game.parseSan("Ng3") == find_move(game, "h1g3"));
+    }
+
+    SECTION("Castling and promotions") {
+        game.loadFen("r3k2r/1P6/8/8/8/8/8/R3K2R w KQkq - 0 1");
+        REQUIRE(game.parseSan("O-O") == find_move(game, "e1g1"));
+        REQUIRE(game.parseSan("0-0-0") == find_move(game, "e1c1"));
+        REQUIRE(game.parseSan("bxa8=Q+") == find_move(game, "b7a8q"));
+        REQUIRE(game.parseSan("b8N") == find_move(game, "b7b8n"));
+    }
+
+    SECTION("Writing notation") {
+        game.loadFen("4k3/8/8/8/8/R7/8/R1R1K2N w - - 0 1");
+        REQUIRE(game.toSan(find_move(game, "a1b1")) == "Rab1");
+        REQUIRE(game.toSan(find_move(game, "a1a2")) == "R1a2");
+        REQUIRE(game.toSan(find_move(game, "a3a8")) == "Ra8+");
+        REQUIRE(game.toSan(find_move(game, "h1g3")) == "Ng3");
+        game.loadFen("r3k2r/1P6/8/8/8/8/8/R3K2R w KQkq - 0 1");
+        REQUIRE(game.toSan(find_move(game, "b7a8q")) == "bxa8=Q+");
+        REQUIRE(game.toSan(find_move(game, "e1c1")) == "O-O-O");
+        game.loadFen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+        REQUIRE(game.toSan(find_move(game, "d1d8")) == "Rd8#");
+        for (auto fen : Mondfisch::Bench::positions) {
+            game.loadFen(std::string(fen));
+            Mondfisch::MoveList moves;
+            game.legal_moves(moves);
+            for (auto move : moves) {
+                REQUIRE(game.parseSan(game.toSan(move.move)) == move.move);
+            }
+        }
+    }
+
+    SECTION("Epd operations") {
+        Mondfisch::Epd::Entry entry;
+        REQUIRE(Mondfisch::Epd::parse("r1b2rk1/1p1nbppp/pq1p4/3B4/P2NP3/2N1p3/1PP3PP/R2Q1R1K w - - "
+                                      "bm Rxf7; id \"arasan2024.2\"; c0 \"Van der Wiel-Ribli\";",
+                                      game, entry));
+        REQUIRE(entry.id == "arasan2024.2");
+        REQUIRE(entry.bestMoves.size() == 1);
+        REQUIRE(entry.solvedBy(find_move(game, "f1f7")));
+        REQUIRE_FALSE(entry.solvedBy(find_move(game, "d4f5")));
+        REQUIRE(Mondfisch::Epd::parse(
+            "k1b4r/1p3p2/pq2pNp1/5n1p/P3QP2/1P1R1BPP/2P5/1K6 b - - am Nxg3; id \"arasan2024.50\";",
+            game, entry));
+        REQUIRE_FALSE(entry.solvedBy(find_move(game, "f5g3")));
+        REQUIRE(entry.solvedBy(find_move(game, "b6b3")));
+    }
+}
+
+TEST_CASE("Batch evaluation", "[batch]") {
+    Mondfisch::initConstants();
+
+    SECTION("Fen from epd") {
+        using Mondfisch::Batch::epd_to_fen;
+        REQUIRE(epd_to_fen("r1bq1r1k/p1pnbpp1/1p2p3/6p1/3PB3/5N2/PPPQ1PPP/2KR3R w - - bm g4; id "
+                           "\"arasan2024.1\";") ==
+                "r1bq1r1k/p1pnbpp1/1p2p3/6p1/3PB3/5N2/PPPQ1PPP/2KR3R w - - 0 1");
+        REQUIRE(epd_to_fen("4k3/8/8/8/8/8/8/4K3 b - - 12 40") == "4k3/8/8/8/8/8/8/4K3 b - - 12 40");
+        REQUIRE(epd_to_fen("4k3/8/8/8/8/8/8/4K3 w - -") == "4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    }
+
+    SECTION("Results do not depend on the number of threads") {
+        std::vector<std::string> lines(Mondfisch::Bench::positions.begin(),
+                                       Mondfisch::Bench::positions.begin() + 12);
+        Mondfisch::Batch::Options options{.depth = 3, .threads = 1};
+        std::vector<Mondfisch::Batch::Result> single;
+        Mondfisch::Batch::evaluate(lines, options, single);
+        options.threads = 4;
+        std::vector<Mondfisch::Batch::Result> parallel;
+        auto summary = Mondfisch::Batch::evaluate(lines, options, parallel);
+
+        REQUIRE(parallel.size() == lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            REQUIRE(single[i].score == parallel[i].score);
+            REQUIRE(single[i].bestMove == parallel[i].bestMove);
+            REQUIRE(single[i].nodes == parallel[i].nodes);
+        }
+        REQUIRE(summary.positionsPerSecond > 0);
+
+        options.depth = 0;
+        options.nodes = 5000;
+        Mondfisch::Batch::evaluate(lines, options, parallel);
+        for (const auto &result : parallel) {
+            REQUIRE(result.nodes == options.nodes);
+        }
+    }
+
+    SECTION("Static evaluation from the side to move") {
+        std::vector<std::string> lines{"4k3/8/8/8/8/8/8/3QK3 w - - 0 1",
+                                       "4k3/8/8/8/8/8/8/3QK3 b - - 0 1"};
+        std::vector<Mondfisch::Batch::Result> results;
+        Mondfisch::Batch::evaluate(lines, {}, results);
+        Mondfisch::Game game{};
+        game.loadFen(lines[0]);
+        REQUIRE(results[0].score == Mondfisch::Evaluation::tapered_eval(game));
+        REQUIRE(results[0].score > 500);
+        REQUIRE(results[1].score < -500);
+        REQUIRE(results[0].nodes == 0);
+    }
+
+    SECTION("Positions without legal moves") {
+        std::vector<std::string> lines{"7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",
+                                       "7k/6Q1/6K1/8/8/8/8/8 b - - 0 1"};
+        std::vector<Mondfisch::Batch::Result> results;
+        Mondfisch::Batch::evaluate(lines, {.depth = 3}, results);
+        // stalemate, then mate
+        REQUIRE(results[0].score == 0);
+        REQUIRE(results[1].score == -Mondfisch::Search::mate);
+        for (const auto &result : results) {
+            REQUIRE(result.bestMove == Mondfisch::Move{});
+            REQUIRE(result.bestMove.toSimpleNotation() == "0000");
+        }
+    }
+}
+
+TEST_CASE("Match", "[match]") {
+    Mondfisch::initConstants();
+    using Catch::Matchers::WithinAbs;
+    using Mondfisch::Match::Score;
+
+    SECTION("Statistics") {
+        Score score{.wins = 60, .losses = 20, .draws = 20};
+        REQUIRE(score.games() == 100);
+        REQUIRE_THAT(score.mean(), WithinAbs(0.7, 1e-9));
+        REQUIRE_THAT(score.elo(), WithinAbs(147.1907, 1e-3));
+        REQUIRE_THAT(score.error(), WithinAbs(66.0146, 1e-3));
+        REQUIRE_THAT(score.llr(0, 10), WithinAbs(1.73371, 1e-4));
+
+        Score drawish{.wins = 10, .losses = 10, .draws = 80};
+        REQUIRE_THAT(drawish.variance(), WithinAbs(0.05, 1e-9));
+        REQUIRE_THAT(drawish.elo(), WithinAbs(0, 1e-9));
+        REQUIRE_THAT(drawish.llr(0, 10), WithinAbs(-0.206991, 1e-5));
+
+        Score empty{};
+        REQUIRE(empty.elo() == 0);
+        REQUIRE(empty.error() == 0);
+        REQUIRE(empty.llr(0, 10) == 0);
+        empty.add(1);
+        empty.add(0);
+        empty.add(-1);
+        REQUIRE(empty.wins == 1);
+        REQUIRE(empty.draws == 1);
+        REQUIRE(empty.losses == 1);
+
+        Mondfisch::Match::Sprt sprt(0.05, 0.05);
+        REQUIRE_THAT(sprt.lower, WithinAbs(-2.944439, 1e-6));
+        REQUIRE_THAT(sprt.upper, WithinAbs(2.944439, 1e-6));
     }
 
-    if (pos == std::string::npos)
-        return epd + " 0 1";
-    return epd.substr(0, pos) + " 0 1";
+    SECTION("Games") {
+        Mondfisch::Api::Engine white{1};
+        Mondfisch::Api::Engine black{1};
+        Mondfisch::Match::TimeControl control{.nodes = 2000};
+
+        // the start position occurs for the third time after the opening
+        Mondfisch::Match::Opening repeated{
+            .fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            .moves = {"g1f3", "g8f6", "f3g1", "f6g8", "g1f3", "g8f6", "f3g1", "f6g8"}};
+        auto record = Mondfisch::Match::play(white, black, repeated, control);
+        REQUIRE(record.result == 0);
+        REQUIRE(record.termination == "draw by rule");
+        REQUIRE(record.movetext == "1. Nf3 Nf6 2. Ng1 Ng8 3. Nf3 Nf6 4. Ng1 Ng8");
+
+        Mondfisch::Match::Opening queen{.fen = "4k3/8/8/8/8/8/8/3QK3 w - - 0 1"};
+        record = Mondfisch::Match::play(white, black, queen, control);
+        REQUIRE(record.result == 1);
+        REQUIRE(Mondfisch::Match::to_pgn(record, 1, "a", "b").find("[Result \"1-0\"]") !=
+                std::string::npos);
+    }
+}
+
+TEST_CASE("Logger", "[logger]") {
+    const std::string filename = "logger_test.log";
+    std::remove(filename.c_str());
+    Mondfisch::Logger log{};
+    REQUIRE(log.open(filename));
+    log.setLevel(Mondfisch::LogLevel::INFO);
+
+    allocations = 0;
+    countAllocations = true;
+    log.info("depth {} nodes {}", 12, 345678);
+    log.debug("filtered {}", 1);
+    countAllocations = false;
+    REQUIRE(allocations == 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&log, t]() {
+            for (int i = 0; i < 500; i++) {
+                log.warn("thread {} message {}", t, i);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    log.close();
+
+    std::ifstream file(filename);
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    // header, one info line and the messages of all threads
+    REQUIRE(lines.size() == 2 + 4 * 500);
+    REQUIRE(lines[1].ends_with("info  depth 12 nodes 345678"));
+    REQUIRE(std::count_if(lines.begin(), lines.end(), [](const std::string &l) {
+                return l.find("warn  thread 3 message") != std::string::npos;
+            }) == 500);
+    std::remove(filename.c_str());
 }
 
-TEST_CASE("Draw Detection", "[draw]") {
+/*TEST_CASE("Draw Detection", "[draw]") {
     Mondfisch::initConstants();
     Mondfisch::Game game{};
     Mondfisch::Search::TranspositionTable table{};
@@ -241,7 +1118,7 @@ TEST_CASE("Draw Detection", "[draw]") {
         std::string line;
         while (std::getline(arasan, line)) {
             std::stringstream ss(line);
-            std::string fen = epd_to_fen_fast(line);
+            std::string fen = Mondfisch::Batch::epd_to_fen(line);
             game.loadFen(fen);
             game.showBoard();
             auto res = Mondfisch::Search::iterative_deepening(ctx, game, 10);
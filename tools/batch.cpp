@@ -0,0 +1,85 @@
+#include "batch.h"
+#include "game.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Scores a file of fen or epd lines with the static evaluation or a shallow search.
+//
+// usage: batch [--in file] [--out file] [--depth n] [--nodes n] [--threads n] [--hash mb]
+//
+// Lines are read from stdin without --in and written to stdout without --out, one line per
+// position in input order: "<fen>;<score>;<bestmove>;<nodes>" with the score in centipawns from
+// the view of the side to move and bestmove "-" for the static evaluation (neither --depth nor
+// --nodes, the default). --nodes alone searches without a depth limit. The throughput is reported
+// on stderr.
+
+using namespace Mondfisch;
+
+int main(int argc, char **argv) {
+    std::string in;
+    std::string out;
+    Batch::Options options{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        if (arg == "--in") {
+            in = argv[i + 1];
+        } else if (arg == "--out") {
+            out = argv[i + 1];
+        } else if (arg == "--depth") {
+            options.depth = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--nodes") {
+            options.nodes = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--hash") {
+            options.hash = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    std::ifstream file;
+    if (!in.empty()) {
+        file.open(in);
+        if (!file.is_open()) {
+            std::print(stderr, "could not open {}\n", in);
+            return 2;
+        }
+    }
+    std::istream &input = in.empty() ? std::cin : file;
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty()) {
+            lines.push_back(std::move(line));
+        }
+    }
+
+    initConstants();
+    std::vector<Batch::Result> results;
+    Batch::Summary summary = Batch::evaluate(lines, options, results);
+
+    std::FILE *output = out.empty() ? stdout : std::fopen(out.c_str(), "w");
+    if (output == nullptr) {
+        std::print(stderr, "could not open {}\n", out);
+        return 2;
+    }
+    for (size_t i = 0; i < lines.size(); i++) {
+        const Batch::Result &result = results[i];
+        std::string move = !options.searches() ? "-" : result.bestMove.toSimpleNotation();
+        std::print(output, "{};{};{};{}\n", Batch::epd_to_fen(lines[i]), result.score, move,
+                   result.nodes);
+    }
+    if (output != stdout) {
+        std::fclose(output);
+    }
+
+    std::print(stderr, "{} positions in {} ms, {:.0f} positions/s, {} nodes\n", lines.size(),
+               summary.elapsed, summary.positionsPerSecond, summary.nodes);
+    return 0;
+}
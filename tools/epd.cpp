@@ -0,0 +1,114 @@
+#include "epd.h"
+#include "game.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runs an epd test suite and reports how many positions the engine solves.
+//
+// usage: epd <file> [--time ms] [--nodes n] [--depth n] [--threads n] [--hash mb] [--quiet]
+//
+// Every position with a bm or am operation is searched from cleared tables with the given limits,
+// 1000 ms without any. The positions are spread over the threads. A position is solved if the
+// final best move is one of bm and none of am. The time and nodes to solution are taken at the
+// iteration from which on the best move solved the position.
+
+using namespace Mondfisch;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::print(stderr, "usage: epd <file> [--time ms] [--nodes n] [--depth n] [--threads n] "
+                           "[--hash mb] [--quiet]\n");
+        return 2;
+    }
+    Epd::Options options{};
+    bool quiet = false;
+    for (int i = 2; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--quiet") {
+            quiet = true;
+        } else if (i + 1 >= argc) {
+            break;
+        } else if (arg == "--time") {
+            options.time = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--nodes") {
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--depth") {
+            options.depth = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--hash") {
+            options.hash = std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+    if (options.time == 0 && options.nodes == 0 && options.depth == 0) {
+        options.time = 1000;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file.is_open()) {
+        std::print(stderr, "could not open {}\n", argv[1]);
+        return 2;
+    }
+
+    initConstants();
+    Game game{};
+    std::vector<Epd::Entry> entries;
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty()) {
+            continue;
+        }
+        Epd::Entry entry;
+        if (!Epd::parse(line, game, entry)) {
+            std::print(stderr, "skipping line {}: no valid bm or am\n", lineNumber);
+            continue;
+        }
+        if (entry.id.empty()) {
+            entry.id = std::to_string(lineNumber);
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    std::vector<Epd::Result> results;
+    Epd::Summary summary = Epd::run(entries, options, results);
+
+    double timeToSolution = 0;
+    double nodesToSolution = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Epd::Result &result = results[i];
+        if (result.solved) {
+            timeToSolution += result.timeToSolution;
+            nodesToSolution += result.nodesToSolution;
+        }
+        if (quiet) {
+            continue;
+        }
+        std::print("{:<20} {:<8} {:<6} depth {:>2} time {:>6} nodes {:>10}", entries[i].id,
+                   result.solved ? "solved" : "failed", result.bestMove.toSimpleNotation(),
+                   result.depth, result.elapsed, result.nodes);
+        if (result.solved) {
+            std::print("  tts {:>6} nts {:>10}", result.timeToSolution, result.nodesToSolution);
+        }
+        std::print("\n");
+    }
+
+    uint32_t solved = std::max<uint32_t>(summary.solved, 1);
+    double cpuSeconds = std::max<int64_t>(summary.searchTime, 1) / 1000.0;
+    std::print("\n===========================\n");
+    std::print("Solved          : {}/{}\n", summary.solved, entries.size());
+    std::print("Time to solve   : {:.0f} ms average\n", timeToSolution / solved);
+    std::print("Nodes to solve  : {:.0f} average\n", nodesToSolution / solved);
+    std::print("Total time (ms) : {}\n", summary.elapsed);
+    std::print("Search time (ms): {}\n", summary.searchTime);
+    std::print("Nodes searched  : {}\n", summary.nodes);
+    std::print("Nodes/second    : {}\n", summary.nps);
+    std::print("Solved/second   : {:.3f}\n", summary.solved / cpuSeconds);
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include "api.h"
+#include "batch.h"
+#include "game.h"
+#include "match.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Plays games between two configurations of the engine inside one process.
+//
+// usage: match [--engine1 options] [--engine2 options] [--games n] [--concurrency n]
+//              [--openings file] [--plies n] [--tc seconds+increment] [--nodes n] [--hash mb]
+//              [--pgn file] [--sprt elo0 elo1] [--seed n]
+//
+// A configuration is a comma separated list of uci options, e.g. "SearchVariant=NoLmr" or
+// "LmrBase=120,LmrDivisor=280".
+// The openings are the fen or epd lines of a file in random order, without a file every opening
+// is --plies (default 8) random moves from the start position. Each opening is played twice with
+// swapped colors. Moves are searched with the time control or a fixed number of nodes, 10000
+// nodes if neither is given. Games end by the rules, by a time forfeit or by the adjudication
+// described in match.h.
+//
+// Results are counted from the view of engine1. After every game the score, the elo estimate and
+// with --sprt the log likelihood ratio of the sequential probability ratio test are printed; the
+// match stops once the test accepts one of the hypotheses.
+
+using namespace Mondfisch;
+using namespace Mondfisch::Match;
+
+namespace {
+
+// error probabilities of the sprt
+constexpr double sprt_alpha = 0.05;
+constexpr double sprt_beta = 0.05;
+
+struct Config {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> options;
+};
+
+struct Options {
+    Config engines[2];
+    uint32_t games = 100;
+    uint32_t concurrency = 1;
+    std::string openings;
+    uint32_t plies = 8;
+    TimeControl control;
+    uint32_t hash = 16;
+    std::string pgn;
+    bool sprt = false;
+    double elo0 = 0;
+    double elo1 = 5;
+    uint64_t seed = 1;
+};
+
+struct Player {
+    Api::Engine engine;
+
+    Player(const Config &config, uint32_t hash) : engine(hash) {
+        for (const auto &[name, value] : config.options) {
+            engine.setOption(name, value);
+        }
+    }
+};
+
+struct Players {
+    Player first;
+    Player second;
+
+    explicit Players(const Options &options)
+        : first(options.engines[0], options.hash), second(options.engines[1], options.hash) {}
+};
+
+Config parse_config(std::string name, std::string_view list) {
+    Config config{.name = std::move(name)};
+    while (!list.empty()) {
+        size_t end = std::min(list.find(','), list.size());
+        std::string_view option = list.substr(0, end);
+        list.remove_prefix(std::min(end + 1, list.size()));
+        size_t equals = option.find('=');
+        if (equals != std::string_view::npos) {
+            config.options.emplace_back(option.substr(0, equals), option.substr(equals + 1));
+        }
+    }
+    return config;
+}
+
+bool parse_options(int argc, char **argv, Options &options) {
+    options.engines[0] = parse_config("engine1", "");
+    options.engines[1] = parse_config("engine2", "");
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string_view arg = argv[i];
+        std::string_view value = argv[i + 1];
+        if (arg == "--engine1" || arg == "--engine2") {
+            options.engines[arg.back() - '1'] = parse_config(std::string(arg.substr(2)), value);
+        } else if (arg == "--games") {
+            options.games = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--concurrency") {
+            options.concurrency = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--openings") {
+            options.openings = value;
+        } else if (arg == "--plies") {
+            options.plies = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--tc") {
+            char *end;
+            options.control.base = std::strtod(argv[i + 1], &end) * 1000;
+            options.control.increment = *end == '+' ? std::strtod(end + 1, nullptr) * 1000 : 0;
+        } else if (arg == "--nodes") {
+            options.control.nodes = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--hash") {
+            options.hash = std::strtoul(argv[i + 1], nullptr, 10);
+        } else if (arg == "--pgn") {
+            options.pgn = value;
+        } else if (arg == "--sprt" && i + 2 < argc) {
+            options.sprt = true;
+            options.elo0 = std::strtod(argv[i + 1], nullptr);
+            options.elo1 = std::strtod(argv[i + 2], nullptr);
+            i++;
+        } else if (arg == "--seed") {
+            options.seed = std::strtoull(argv[i + 1], nullptr, 10);
+        } else {
+            std::print(stderr, "unknown option {}\n", arg);
+            return false;
+        }
+    }
+    if (options.control.base == 0 && options.control.nodes == 0) {
+        options.control.nodes = 10000;
+    }
+    // every opening is played with both colors
+    options.games += options.games % 2;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options{};
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+    initConstants();
+
+    // reject unknown options before any game starts
+    {
+        Api::Engine engine{1};
+        for (const Config &config : options.engines) {
+            for (const auto &[name, value] : config.options) {
+                if (!engine.setOption(name, value)) {
+                    std::print(stderr, "unknown engine option {}\n", name);
+                    return 2;
+                }
+            }
+        }
+    }
+
+    std::vector<Opening> openings;
+    if (!options.openings.empty()) {
+        std::ifstream file(options.openings);
+        if (!file.is_open()) {
+            std::print(stderr, "could not open {}\n", options.openings);
+            return 2;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                openings.push_back({Batch::epd_to_fen(line), {}});
+            }
+        }
+        std::shuffle(openings.begin(), openings.end(), std::mt19937_64(options.seed));
+    }
+
+    std::FILE *pgn = nullptr;
+    if (!options.pgn.empty()) {
+        pgn = std::fopen(options.pgn.c_str(), "w");
+        if (pgn == nullptr) {
+            std::print(stderr, "could not open {}\n", options.pgn);
+            return 2;
+        }
+    }
+
+    std::mutex mutex;
+    Score score{};
+    bool finished = false;
+    std::print("{} vs {}, {} games\n", options.engines[0].name, options.engines[1].name,
+               options.games);
+    if (options.sprt) {
+        std::print("SPRT elo0 {} elo1 {} alpha {} beta {}\n", options.elo0, options.elo1,
+                   sprt_alpha, sprt_beta);
+    }
+    Sprt sprt(sprt_alpha, sprt_beta);
+
+    Batch::parallel_for(
+        options.games, options.concurrency, [&]() { return Players(options); },
+        [&](Players &players, size_t game) {
+            {
+                std::lock_guard lock(mutex);
+                if (finished) {
+                    return;
+                }
+            }
+            size_t pair = game / 2;
+            Opening opening = openings.empty()
+                                  ? random_opening(options.plies, options.seed + pair)
+                                  : openings[pair % openings.size()];
+            bool firstIsWhite = game % 2 == 0;
+            Api::Engine &first = players.first.engine;
+            Api::Engine &second = players.second.engine;
+            GameRecord record = firstIsWhite ? play(first, second, opening, options.control)
+                                             : play(second, first, opening, options.control);
+
+            std::lock_guard lock(mutex);
+            // another game may have ended the match while this one was played
+            if (finished) {
+                return;
+            }
+            score.add(firstIsWhite ? record.result : -record.result);
+            if (pgn != nullptr) {
+                const std::string &firstName = options.engines[0].name;
+                const std::string &secondName = options.engines[1].name;
+                std::string text = firstIsWhite
+                                       ? to_pgn(record, game + 1, firstName, secondName)
+                                       : to_pgn(record, game + 1, secondName, firstName);
+                std::fwrite(text.data(), 1, text.size(), pgn);
+                std::fflush(pgn);
+            }
+
+            std::print("Game {:>5} {:<8} {:<30} | {} - {} - {} elo {:.1f} +- {:.1f}",
+                       game + 1, result_string(record.result), record.termination, score.wins,
+                       score.losses, score.draws, score.elo(), score.error());
+            if (options.sprt) {
+                double llr = score.llr(options.elo0, options.elo1);
+                std::print(" llr {:.2f} ({:.2f}, {:.2f})", llr, sprt.lower, sprt.upper);
+                if (llr <= sprt.lower || llr >= sprt.upper) {
+                    finished = true;
+                    std::print("\nSPRT accepts {}", llr >= sprt.upper ? "H1" : "H0");
+                }
+            }
+            std::print("\n");
+            std::fflush(stdout);
+        });
+
+    if (pgn != nullptr) {
+        std::fclose(pgn);
+    }
+    std::print("\n===========================\n");
+    std::print("Games           : {}\n", score.games());
+    std::print("Wins/losses/draws: {}/{}/{}\n", score.wins, score.losses, score.draws);
+    std::print("Elo             : {:.1f} +- {:.1f}\n", score.elo(), score.error());
+    return 0;
+}
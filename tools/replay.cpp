@@ -0,0 +1,105 @@
+#include "game.h"
+#include "session.h"
+#include "uci.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Replays a session recorded with --record and measures every go of it.
+//
+// usage: replay <session> [--verbose]
+//
+// The input lines are fed to a fresh engine in order, as fast as it takes them. For every go the
+// report shows the time the engine allotted itself, the latency from go to bestmove in the
+// recording (from the previous bestmove for a go that waited for it) and in the replay, how far
+// the replay went over the allotted time and the search speed. The output of the engine is
+// discarded, with --verbose it goes to stderr.
+
+using namespace Mondfisch;
+using Mondfisch::Session::Event;
+
+namespace {
+
+struct GoReport {
+    std::string command;
+    uint64_t allotted;
+    double recorded;
+    double replayed;
+    uint32_t depth;
+    uint64_t nodes;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::print(stderr, "usage: replay <session> [--verbose]\n");
+        return 2;
+    }
+    bool verbose = argc > 2 && std::string_view(argv[2]) == "--verbose";
+
+    std::vector<Event> events = Session::load(argv[1]);
+    if (events.empty()) {
+        std::print(stderr, "no events in {}\n", argv[1]);
+        return 2;
+    }
+    std::vector<double> latencies = Session::recorded_latencies(events);
+
+    initConstants();
+    IO::out = verbose ? stderr : nullptr;
+    UciEngine engine{};
+
+    std::vector<GoReport> reports;
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event &event = events[i];
+        if (event.direction != '<') {
+            continue;
+        }
+        if (!Session::is_search(event.line)) {
+            if (!engine.handle(event.line)) {
+                break;
+            }
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        engine.handle(event.line);
+        auto end = std::chrono::steady_clock::now();
+        reports.push_back(GoReport{
+            .command = event.line,
+            .allotted = engine.ctx.thinkingTime,
+            .recorded = latencies[reports.size()],
+            .replayed = std::chrono::duration<double, std::milli>(end - start).count(),
+            .depth = engine.lastResult.depth,
+            .nodes = engine.ctx.nodes,
+        });
+    }
+
+    std::print("{:>4} {:>9} {:>10} {:>10} {:>10} {:>6} {:>10} {:>9}  {}\n", "go", "allotted",
+               "recorded", "replayed", "overshoot", "depth", "nodes", "nps", "command");
+    uint32_t overshoots = 0;
+    double maxOvershoot = 0;
+    double totalTime = 0;
+    uint64_t totalNodes = 0;
+    for (size_t i = 0; i < reports.size(); i++) {
+        const GoReport &report = reports[i];
+        double overshoot =
+            report.allotted > 0 ? std::max(0.0, report.replayed - double(report.allotted)) : 0;
+        overshoots += overshoot > 0;
+        maxOvershoot = std::max(maxOvershoot, overshoot);
+        totalTime += report.replayed;
+        totalNodes += report.nodes;
+        uint64_t nps = report.replayed > 0 ? report.nodes * 1000 / report.replayed : 0;
+        std::print("{:>4} {:>9} {:>10.1f} {:>10.1f} {:>10.1f} {:>6} {:>10} {:>9}  {}\n", i + 1,
+                   report.allotted, report.recorded, report.replayed, overshoot, report.depth,
+                   report.nodes, nps, report.command);
+    }
+    uint64_t nps = totalTime > 0 ? totalNodes * 1000 / totalTime : 0;
+    std::print("\n{} searches, {} over the allotted time (max {:.1f}ms), {:.1f}ms total, "
+               "{} nps\n",
+               reports.size(), overshoots, maxOvershoot, totalTime, nps);
+    return 0;
+}